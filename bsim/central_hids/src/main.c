@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Simulated HID central for the peripheral HIDS mouse performance lab.
+ *
+ * The central connects to the mouse, subscribes to all input reports and
+ * measures the connect time, the time to the first report, the number of
+ * notifications per second and the report inter-arrival times. It then
+ * disconnects and measures the reconnect time for a number of cycles.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include <bluetooth/gatt_dm.h>
+#include <bluetooth/services/hogp.h>
+
+/* Time for which notifications are counted on each connection. */
+#define MEASURE_WINDOW_MS       10000
+/* Number of disconnect-reconnect cycles. */
+#define RECONNECT_CYCLES        5
+/* Width of a single inter-arrival histogram bucket. */
+#define ARRIVAL_BUCKET_US       250
+/* Number of inter-arrival histogram buckets. */
+#define ARRIVAL_BUCKET_COUNT    64
+/* Highest input report ID counted separately. */
+#define REPORT_ID_MAX           4
+
+/* 7.5 ms connection interval, as requested by low-latency HID hosts. */
+#define CONN_PARAM BT_LE_CONN_PARAM(6, 6, 0, 400)
+
+static struct bt_conn *default_conn;
+static struct bt_hogp hogp;
+
+static struct measurement {
+	int64_t scan_start_ms;
+	int64_t connected_ms;
+	int64_t disconnected_ms;
+	int64_t ready_ms;
+	int64_t first_report_ms;
+	uint32_t last_arrival_cyc;
+	uint32_t notifications;
+	uint32_t per_report[REPORT_ID_MAX + 1];
+	uint32_t arrival_hist[ARRIVAL_BUCKET_COUNT];
+	uint32_t cycle;
+} m;
+
+static void scan_start(void);
+
+static void measurement_done(struct k_work *work)
+{
+	int err;
+
+	err = bt_conn_disconnect(default_conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+	if (err) {
+		printk("Failed to disconnect (err %d)\n", err);
+	}
+}
+
+static K_WORK_DELAYABLE_DEFINE(measurement_work, measurement_done);
+
+static uint32_t arrival_percentile(uint8_t percentile)
+{
+	uint32_t threshold = DIV_ROUND_UP(m.notifications * percentile, 100);
+	uint32_t count = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(m.arrival_hist); i++) {
+		count += m.arrival_hist[i];
+		if (count >= threshold) {
+			return (i + 1) * ARRIVAL_BUCKET_US;
+		}
+	}
+
+	return ARRIVAL_BUCKET_COUNT * ARRIVAL_BUCKET_US;
+}
+
+static void measurement_print(void)
+{
+	int64_t window_ms = MAX(k_uptime_get() - m.ready_ms, 1);
+
+	printk("PERF cycle %u: notifications %u (%u/s)\n", m.cycle, m.notifications,
+	       (uint32_t)((m.notifications * 1000LL) / window_ms));
+
+	for (size_t i = 0; i < ARRAY_SIZE(m.per_report); i++) {
+		if (m.per_report[i]) {
+			printk("PERF cycle %u: report id %u: %u\n", m.cycle, i, m.per_report[i]);
+		}
+	}
+
+	if (m.first_report_ms) {
+		printk("PERF cycle %u: connect to first report %lld ms\n", m.cycle,
+		       m.first_report_ms - m.connected_ms);
+	}
+
+	printk("PERF cycle %u: inter-arrival p50 %u us, p90 %u us, p99 %u us\n", m.cycle,
+	       arrival_percentile(50), arrival_percentile(90), arrival_percentile(99));
+}
+
+static uint8_t hogp_notify_cb(struct bt_hogp *hogp, struct bt_hogp_rep_info *rep,
+			      uint8_t err, const uint8_t *data)
+{
+	uint32_t now = k_cycle_get_32();
+	uint8_t id;
+
+	if (!data) {
+		return BT_GATT_ITER_STOP;
+	}
+
+	if (!m.first_report_ms) {
+		m.first_report_ms = k_uptime_get();
+	} else {
+		uint32_t delta_us = k_cyc_to_us_floor32(now - m.last_arrival_cyc);
+
+		m.arrival_hist[MIN(delta_us / ARRIVAL_BUCKET_US, ARRIVAL_BUCKET_COUNT - 1)]++;
+	}
+
+	m.last_arrival_cyc = now;
+	m.notifications++;
+
+	id = bt_hogp_rep_id(rep);
+	if (id <= REPORT_ID_MAX) {
+		m.per_report[id]++;
+	}
+
+	return BT_GATT_ITER_CONTINUE;
+}
+
+static void hogp_ready_cb(struct bt_hogp *hogp)
+{
+	struct bt_hogp_rep_info *rep = NULL;
+	int err;
+
+	while ((rep = bt_hogp_rep_next(hogp, rep)) != NULL) {
+		if (bt_hogp_rep_type(rep) != BT_HIDS_REPORT_TYPE_INPUT) {
+			continue;
+		}
+
+		err = bt_hogp_rep_subscribe(hogp, rep, hogp_notify_cb);
+		if (err) {
+			printk("Subscribe error (%d)\n", err);
+		}
+	}
+
+	m.ready_ms = k_uptime_get();
+	printk("PERF cycle %u: connect to HID ready %lld ms\n", m.cycle,
+	       m.ready_ms - m.connected_ms);
+
+	k_work_schedule(&measurement_work, K_MSEC(MEASURE_WINDOW_MS));
+}
+
+static void hogp_prep_fail_cb(struct bt_hogp *hogp, int err)
+{
+	printk("HID preparation failed (err %d)\n", err);
+}
+
+static void hogp_pm_update_cb(struct bt_hogp *hogp)
+{
+}
+
+static const struct bt_hogp_init_params hogp_init_params = {
+	.ready_cb      = hogp_ready_cb,
+	.prep_error_cb = hogp_prep_fail_cb,
+	.pm_update_cb  = hogp_pm_update_cb,
+};
+
+static void discovery_completed_cb(struct bt_gatt_dm *dm, void *context)
+{
+	int err;
+
+	err = bt_hogp_handles_assign(dm, &hogp);
+	if (err) {
+		printk("Could not init HIDS client object (err %d)\n", err);
+	}
+
+	err = bt_gatt_dm_data_release(dm);
+	if (err) {
+		printk("Could not release the discovery data (err %d)\n", err);
+	}
+}
+
+static void discovery_service_not_found_cb(struct bt_conn *conn, void *context)
+{
+	printk("HID service not found\n");
+}
+
+static void discovery_error_found_cb(struct bt_conn *conn, int err, void *context)
+{
+	printk("Discovery failed (err %d)\n", err);
+}
+
+static const struct bt_gatt_dm_cb discovery_cb = {
+	.completed         = discovery_completed_cb,
+	.service_not_found = discovery_service_not_found_cb,
+	.error_found       = discovery_error_found_cb,
+};
+
+static bool ad_has_hids(struct bt_data *data, void *user_data)
+{
+	bool *found = user_data;
+
+	if ((data->type != BT_DATA_UUID16_ALL) && (data->type != BT_DATA_UUID16_SOME)) {
+		return true;
+	}
+
+	for (size_t i = 0; i + 1 < data->data_len; i += sizeof(uint16_t)) {
+		if (sys_get_le16(&data->data[i]) == BT_UUID_HIDS_VAL) {
+			*found = true;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
+			 struct net_buf_simple *ad)
+{
+	bool found = false;
+	int err;
+
+	if (default_conn) {
+		return;
+	}
+
+	if (type == BT_GAP_ADV_TYPE_ADV_DIRECT_IND) {
+		found = true;
+	} else if (type == BT_GAP_ADV_TYPE_ADV_IND) {
+		bt_data_parse(ad, ad_has_hids, &found);
+	}
+
+	if (!found) {
+		return;
+	}
+
+	err = bt_le_scan_stop();
+	if (err) {
+		printk("Stop LE scan failed (err %d)\n", err);
+		return;
+	}
+
+	err = bt_conn_le_create(addr, BT_CONN_LE_CREATE_CONN, CONN_PARAM, &default_conn);
+	if (err) {
+		printk("Create connection failed (err %d)\n", err);
+		scan_start();
+	}
+}
+
+static void scan_start(void)
+{
+	int err;
+
+	err = bt_le_scan_start(BT_LE_SCAN_PASSIVE, device_found);
+	if (err) {
+		printk("Scanning failed to start (err %d)\n", err);
+		return;
+	}
+
+	if (!m.scan_start_ms) {
+		m.scan_start_ms = k_uptime_get();
+	}
+}
+
+static void connected(struct bt_conn *conn, uint8_t conn_err)
+{
+	int err;
+
+	if (conn_err) {
+		printk("Failed to connect (%u)\n", conn_err);
+		bt_conn_unref(default_conn);
+		default_conn = NULL;
+		scan_start();
+		return;
+	}
+
+	m.connected_ms = k_uptime_get();
+
+	if (m.cycle == 0) {
+		printk("PERF connect time %lld ms\n", m.connected_ms - m.scan_start_ms);
+	} else {
+		printk("PERF cycle %u: reconnect time %lld ms\n", m.cycle,
+		       m.connected_ms - m.disconnected_ms);
+	}
+
+	err = bt_conn_set_security(conn, BT_SECURITY_L2);
+	if (err) {
+		printk("Failed to set security (err %d)\n", err);
+	}
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	if (conn != default_conn) {
+		return;
+	}
+
+	k_work_cancel_delayable(&measurement_work);
+	measurement_print();
+
+	bt_hogp_release(&hogp);
+	bt_conn_unref(default_conn);
+	default_conn = NULL;
+
+	memset(m.per_report, 0, sizeof(m.per_report));
+	memset(m.arrival_hist, 0, sizeof(m.arrival_hist));
+	m.notifications = 0;
+	m.first_report_ms = 0;
+	m.disconnected_ms = k_uptime_get();
+
+	if (++m.cycle > RECONNECT_CYCLES) {
+		printk("PERF done\n");
+		return;
+	}
+
+	scan_start();
+}
+
+static void security_changed(struct bt_conn *conn, bt_security_t level,
+			     enum bt_security_err err)
+{
+	if (err) {
+		printk("Security failed: level %u err %d\n", level, err);
+		return;
+	}
+
+	if (bt_hogp_assign_check(&hogp)) {
+		return;
+	}
+
+	err = bt_gatt_dm_start(conn, BT_UUID_HIDS, &discovery_cb, NULL);
+	if (err) {
+		printk("Could not start the discovery procedure (err %d)\n", err);
+	}
+}
+
+BT_CONN_CB_DEFINE(conn_callbacks) = {
+	.connected = connected,
+	.disconnected = disconnected,
+	.security_changed = security_changed,
+};
+
+int main(void)
+{
+	int err;
+
+	printk("Starting HIDS performance central\n");
+
+	bt_hogp_init(&hogp, &hogp_init_params);
+
+	err = bt_enable(NULL);
+	if (err) {
+		printk("Bluetooth init failed (err %d)\n", err);
+		return 0;
+	}
+
+	scan_start();
+
+	return 0;
+}
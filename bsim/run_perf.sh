@@ -0,0 +1,37 @@
+#!/usr/bin/env bash
+# Copyright (c) 2024 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+# Build the HIDS mouse and the simulated central for nrf52_bsim and run
+# them against each other in BabbleSim. The PERF lines printed by both
+# devices hold the connect, reconnect, notification rate and latency
+# measurements.
+#
+# Requires BSIM_OUT_PATH and BSIM_COMPONENTS_PATH to point at a BabbleSim
+# installation.
+
+set -e
+
+: "${BSIM_OUT_PATH:?BSIM_OUT_PATH must be defined}"
+
+APP_DIR=$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)
+BUILD_DIR=${BUILD_DIR:-${APP_DIR}/build_bsim}
+SIM_ID=${SIM_ID:-hids_mouse_perf}
+SIM_LENGTH_US=${SIM_LENGTH_US:-90e6}
+
+west build -b nrf52_bsim -d "${BUILD_DIR}/mouse" "${APP_DIR}" --no-sysbuild
+west build -b nrf52_bsim -d "${BUILD_DIR}/central" "${APP_DIR}/bsim/central_hids"
+
+cd "${BSIM_OUT_PATH}/bin"
+
+"${BUILD_DIR}/mouse/zephyr/zephyr.exe" -s="${SIM_ID}" -d=0 \
+	> "${BUILD_DIR}/mouse.log" 2>&1 &
+"${BUILD_DIR}/central/zephyr/zephyr.exe" -s="${SIM_ID}" -d=1 \
+	> "${BUILD_DIR}/central.log" 2>&1 &
+./bs_2G4_phy_v1 -s="${SIM_ID}" -D=2 -sim_length="${SIM_LENGTH_US}"
+
+wait
+
+grep -h "PERF\|^Load\|^reports\|^latency\|^hids_queue\|^samples" \
+	"${BUILD_DIR}/mouse.log" "${BUILD_DIR}/central.log"
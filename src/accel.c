@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/shell/shell.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "accel.h"
+
+/* Number of gain table intervals, the table has one more entry. */
+#define LUT_INTERVALS           16
+/* Fixed point shift of the gain and of the remainders. */
+#define GAIN_SHIFT              8
+#define GAIN_ONE                BIT(GAIN_SHIFT)
+/* Largest gain in percent, keeps the Q8 products within 32 bits. */
+#define GAIN_PCT_MAX            1000
+
+/* Default number of samples processed by the benchmark. */
+#define BENCH_SAMPLES_DEFAULT   10000
+#define BENCH_SAMPLES_MAX       1000000
+
+BUILD_ASSERT(CONFIG_APP_ACCEL_SPEED_LOW < CONFIG_APP_ACCEL_SPEED_HIGH,
+	     "The acceleration must start below the speed of the maximum gain");
+
+static struct {
+	struct k_spinlock lock;
+	struct accel_config config;
+	/* Gain in Q8 at speed (i << shift). */
+	uint16_t lut[LUT_INTERVALS + 1];
+	uint8_t shift;
+} accel;
+
+/* Smoothstep from 0 at speed_low to GAIN_ONE at speed_high. */
+static uint32_t ramp_get(const struct accel_config *config, uint32_t speed)
+{
+	uint32_t t;
+
+	if (speed <= config->speed_low) {
+		return 0;
+	}
+
+	if (speed >= config->speed_high) {
+		return GAIN_ONE;
+	}
+
+	t = ((speed - config->speed_low) << GAIN_SHIFT) /
+	    (config->speed_high - config->speed_low);
+
+	return (t * t * (3 * GAIN_ONE - 2 * t)) >> (2 * GAIN_SHIFT);
+}
+
+int accel_configure(const struct accel_config *config)
+{
+	uint16_t lut[LUT_INTERVALS + 1];
+	k_spinlock_key_t key;
+	uint8_t shift = 0;
+
+	if (!config->sensitivity || (config->sensitivity > GAIN_PCT_MAX) ||
+	    (config->gain_max < 100) || (config->gain_max > GAIN_PCT_MAX) ||
+	    (config->speed_low >= config->speed_high)) {
+		return -EINVAL;
+	}
+
+	/* Smallest power of two interval covering the curve with the table. */
+	while ((LUT_INTERVALS << shift) < config->speed_high) {
+		shift++;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(lut); i++) {
+		uint32_t ramp = ramp_get(config, i << shift);
+		uint32_t gain = 100 * GAIN_ONE + (config->gain_max - 100) * ramp;
+
+		gain = (gain / 100) * config->sensitivity / 100;
+
+		lut[i] = MIN(gain, UINT16_MAX);
+	}
+
+	key = k_spin_lock(&accel.lock);
+	accel.config = *config;
+	memcpy(accel.lut, lut, sizeof(accel.lut));
+	accel.shift = shift;
+	k_spin_unlock(&accel.lock, key);
+
+	return 0;
+}
+
+void accel_config_get(struct accel_config *config)
+{
+	k_spinlock_key_t key = k_spin_lock(&accel.lock);
+
+	*config = accel.config;
+
+	k_spin_unlock(&accel.lock, key);
+}
+
+/* Interpolated gain in Q8, must be called with the lock held. */
+static uint32_t gain_get(uint32_t speed)
+{
+	uint32_t i = speed >> accel.shift;
+	uint32_t frac = speed & BIT_MASK(accel.shift);
+	int32_t lo;
+	int32_t hi;
+
+	if (i >= LUT_INTERVALS) {
+		return accel.lut[LUT_INTERVALS];
+	}
+
+	lo = accel.lut[i];
+	hi = accel.lut[i + 1];
+
+	return lo + (((hi - lo) * (int32_t)frac) >> accel.shift);
+}
+
+static int16_t axis_apply(int32_t *rem, int16_t delta, uint32_t gain)
+{
+	int32_t value = delta * (int32_t)gain + *rem;
+	/* Arithmetic shift rounds towards minus infinity, the remainder is
+	 * therefore always positive and does not bias either direction.
+	 */
+	int32_t out = value >> GAIN_SHIFT;
+
+	*rem = value - (out * GAIN_ONE);
+
+	return CLAMP(out, INT16_MIN, INT16_MAX);
+}
+
+void accel_apply(struct accel_state *state, int16_t *x_delta, int16_t *y_delta)
+{
+	uint32_t dx = abs(*x_delta);
+	uint32_t dy = abs(*y_delta);
+	/* Euclidean speed approximation, max + min / 2. */
+	uint32_t speed = MAX(dx, dy) + (MIN(dx, dy) >> 1);
+	k_spinlock_key_t key;
+	uint32_t gain;
+
+	key = k_spin_lock(&accel.lock);
+	gain = gain_get(speed);
+	*x_delta = axis_apply(&state->rem_x, *x_delta, gain);
+	*y_delta = axis_apply(&state->rem_y, *y_delta, gain);
+	k_spin_unlock(&accel.lock, key);
+}
+
+static int accel_init(void)
+{
+	const struct accel_config config = {
+		.sensitivity = CONFIG_APP_ACCEL_SENSITIVITY,
+		.gain_max = CONFIG_APP_ACCEL_GAIN_MAX,
+		.speed_low = CONFIG_APP_ACCEL_SPEED_LOW,
+		.speed_high = CONFIG_APP_ACCEL_SPEED_HIGH,
+	};
+	/* Pass the motion through unchanged rather than dropping it. */
+	const struct accel_config unity = {
+		.sensitivity = 100,
+		.gain_max = 100,
+		.speed_low = 0,
+		.speed_high = 1,
+	};
+	int err;
+
+	err = accel_configure(&config);
+	if (err) {
+		printk("Invalid acceleration curve (err %d), using unity gain\n", err);
+		err = accel_configure(&unity);
+	}
+
+	return err;
+}
+
+SYS_INIT(accel_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#if defined(CONFIG_SHELL)
+static int cmd_accel_show(const struct shell *sh, size_t argc, char **argv)
+{
+	struct accel_config config;
+	uint16_t lut[LUT_INTERVALS + 1];
+	k_spinlock_key_t key;
+	uint8_t shift;
+
+	key = k_spin_lock(&accel.lock);
+	config = accel.config;
+	memcpy(lut, accel.lut, sizeof(lut));
+	shift = accel.shift;
+	k_spin_unlock(&accel.lock, key);
+
+	shell_print(sh, "sensitivity %u%%, gain max %u%%, speed %u..%u",
+		    config.sensitivity, config.gain_max, config.speed_low, config.speed_high);
+
+	for (size_t i = 0; i < ARRAY_SIZE(lut); i++) {
+		shell_print(sh, "speed %5u: gain %3u.%02u", (uint32_t)(i << shift),
+			    lut[i] >> GAIN_SHIFT, ((lut[i] & BIT_MASK(GAIN_SHIFT)) * 100) >> GAIN_SHIFT);
+	}
+
+	return 0;
+}
+
+static int cmd_accel_set(const struct shell *sh, size_t argc, char **argv)
+{
+	struct accel_config config;
+	unsigned long value[4];
+	int err = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(value); i++) {
+		value[i] = shell_strtoul(argv[i + 1], 0, &err);
+		if (!err && (value[i] > UINT16_MAX)) {
+			err = -ERANGE;
+		}
+	}
+
+	if (err) {
+		shell_error(sh, "Invalid curve parameters");
+		return err;
+	}
+
+	config.sensitivity = value[0];
+	config.gain_max = value[1];
+	config.speed_low = value[2];
+	config.speed_high = value[3];
+
+	err = accel_configure(&config);
+	if (err) {
+		shell_error(sh, "Invalid curve (err %d)", err);
+	}
+
+	return err;
+}
+
+static int cmd_accel_bench(const struct shell *sh, size_t argc, char **argv)
+{
+	unsigned long samples = BENCH_SAMPLES_DEFAULT;
+	struct accel_state state = {0};
+	uint32_t start;
+	uint32_t cycles;
+	int err = 0;
+
+	if (argc > 1) {
+		samples = shell_strtoul(argv[1], 0, &err);
+		if (err || !samples || (samples > BENCH_SAMPLES_MAX)) {
+			shell_error(sh, "Invalid sample count");
+			return -EINVAL;
+		}
+	}
+
+	start = k_cycle_get_32();
+
+	for (unsigned long i = 0; i < samples; i++) {
+		/* Cover the whole table, including the saturated end. */
+		int16_t x = (int16_t)(i & 0x1ff) - 0x100;
+		int16_t y = (int16_t)((i * 7) & 0xff) - 0x80;
+
+		accel_apply(&state, &x, &y);
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	shell_print(sh, "%lu samples in %u cycles: %u cycles/sample, %u ns/sample",
+		    samples, cycles, (uint32_t)(cycles / samples),
+		    (uint32_t)(k_cyc_to_ns_floor64(cycles) / samples));
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(accel_cmds,
+	SHELL_CMD(show, NULL, "Show the acceleration curve", cmd_accel_show),
+	SHELL_CMD_ARG(set, NULL,
+		      "Set the curve <sensitivity_pct> <gain_max_pct> <speed_low> <speed_high>",
+		      cmd_accel_set, 5, 0),
+	SHELL_CMD_ARG(bench, NULL, "Measure the CPU cost per sample [samples]",
+		      cmd_accel_bench, 1, 1),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(accel, &accel_cmds, "Pointer acceleration", cmd_accel_show);
+#endif /* defined(CONFIG_SHELL) */
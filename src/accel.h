@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef ACCEL_H_
+#define ACCEL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr/kernel.h>
+
+/** Pointer acceleration curve parameters. */
+struct accel_config {
+	/** Gain below the low speed threshold, in percent. */
+	uint16_t sensitivity;
+	/** Gain above the high speed threshold, in percent of sensitivity. */
+	uint16_t gain_max;
+	/** Speed in counts per sample at which the acceleration starts. */
+	uint16_t speed_low;
+	/** Speed in counts per sample at which the gain reaches its maximum. */
+	uint16_t speed_high;
+};
+
+/** Per-stream acceleration state. */
+struct accel_state {
+	/** Fractional X remainder carried to the next sample, in Q8. */
+	int32_t rem_x;
+	/** Fractional Y remainder carried to the next sample, in Q8. */
+	int32_t rem_y;
+};
+
+#if defined(CONFIG_APP_ACCEL)
+
+/** @brief Set the acceleration curve.
+ *
+ *  Rebuilds the gain lookup table. The new curve applies to the samples
+ *  processed after this call.
+ *
+ *  @param config Curve parameters.
+ *
+ *  @retval 0 if the operation was successful, otherwise a (negative) error code.
+ */
+int accel_configure(const struct accel_config *config);
+
+/** @brief Get the acceleration curve.
+ *
+ *  @param config Curve parameters to fill.
+ */
+void accel_config_get(struct accel_config *config);
+
+/** @brief Apply the acceleration curve to a motion sample.
+ *
+ *  Runs in constant time. The fraction of the result that does not fit
+ *  in whole counts is kept in the state and added to the next sample.
+ *  This function can be called from an interrupt context.
+ *
+ *  @param state Acceleration state of the motion stream.
+ *  @param x_delta Horizontal motion, replaced with the result.
+ *  @param y_delta Vertical motion, replaced with the result.
+ */
+void accel_apply(struct accel_state *state, int16_t *x_delta, int16_t *y_delta);
+
+#else
+
+static inline int accel_configure(const struct accel_config *config) { return -ENOTSUP; }
+static inline void accel_config_get(struct accel_config *config) { *config = (struct accel_config){0}; }
+static inline void accel_apply(struct accel_state *state, int16_t *x_delta, int16_t *y_delta) {}
+
+#endif /* defined(CONFIG_APP_ACCEL) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ACCEL_H_ */
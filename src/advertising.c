@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Advertising with two extended advertising sets.
+ *
+ * The directed set sends high duty cycle directed advertising bursts to
+ * the bonded hosts, one after another from the most recently used one.
+ * The undirected set keeps the device discoverable at the same time, at a
+ * fast interval first and at a slow one once the fast period is over.
+ * All set operations run in the system workqueue.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include "advertising.h"
+#include "bond_cache.h"
+#include "stats.h"
+
+BUILD_ASSERT(IS_ENABLED(CONFIG_BT_EXT_ADV), "Advertising uses extended advertising sets");
+
+#define DEVICE_NAME     CONFIG_BT_DEVICE_NAME
+#define DEVICE_NAME_LEN (sizeof(DEVICE_NAME) - 1)
+
+/* Maximum number of connections that can be established. */
+#define CONN_SLOTS      MIN(CONFIG_BT_MAX_CONN, CONFIG_BT_HIDS_MAX_CLIENT_COUNT)
+
+/* High duty cycle directed advertising ends after 1.28 s, in 10 ms units. */
+#define DIR_ADV_TIMEOUT 128
+
+/* Fast undirected advertising duration in 10 ms units. */
+#define UNDIR_ADV_FAST_TIMEOUT (CONFIG_APP_ADV_FAST_DURATION_S * 100)
+
+#if defined(CONFIG_APP_ADV_PHY_1M)
+#define UNDIR_ADV_OPT   (BT_LE_ADV_OPT_EXT_ADV | BT_LE_ADV_OPT_NO_2M)
+#elif defined(CONFIG_APP_ADV_PHY_2M)
+#define UNDIR_ADV_OPT   BT_LE_ADV_OPT_EXT_ADV
+#elif defined(CONFIG_APP_ADV_PHY_CODED)
+#define UNDIR_ADV_OPT   (BT_LE_ADV_OPT_EXT_ADV | BT_LE_ADV_OPT_CODED)
+#else
+#define UNDIR_ADV_OPT   0
+#endif
+
+enum {
+	/* Requests, the last of them wins. */
+	ADV_REQ_RESTART,
+	ADV_REQ_STOP,
+
+	ADV_DIR_RUNNING,
+	/* All bonded hosts got their directed advertising burst. */
+	ADV_DIR_DONE,
+	ADV_UNDIR_RUNNING,
+	/* The fast undirected advertising period is over. */
+	ADV_UNDIR_SLOW,
+};
+
+static const struct bt_data ad[] = {
+	BT_DATA_BYTES(BT_DATA_GAP_APPEARANCE,
+		      (CONFIG_BT_DEVICE_APPEARANCE >> 0) & 0xff,
+		      (CONFIG_BT_DEVICE_APPEARANCE >> 8) & 0xff),
+	BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
+	BT_DATA_BYTES(BT_DATA_UUID16_ALL, BT_UUID_16_ENCODE(BT_UUID_HIDS_VAL),
+					  BT_UUID_16_ENCODE(BT_UUID_BAS_VAL)),
+#if !defined(CONFIG_APP_ADV_PHY_LEGACY)
+	/* Connectable extended advertising has no scan response. */
+	BT_DATA(BT_DATA_NAME_COMPLETE, DEVICE_NAME, DEVICE_NAME_LEN),
+#endif
+};
+
+#if defined(CONFIG_APP_ADV_PHY_LEGACY)
+static const struct bt_data sd[] = {
+	BT_DATA(BT_DATA_NAME_COMPLETE, DEVICE_NAME, DEVICE_NAME_LEN),
+};
+#endif
+
+static struct bt_le_ext_adv *adv_dir;
+static struct bt_le_ext_adv *adv_undir;
+static atomic_t adv_flags;
+/* Position in the bond cache of the next host to direct advertising to. */
+static atomic_t adv_bond_idx;
+
+static void adv_process(struct k_work *work);
+
+static K_WORK_DEFINE(adv_work, adv_process);
+
+static void adv_sent(struct bt_le_ext_adv *adv, struct bt_le_ext_adv_sent_info *info)
+{
+	if (adv == adv_dir) {
+		/* The burst timed out, continue with the next bond. */
+		atomic_clear_bit(&adv_flags, ADV_DIR_RUNNING);
+	} else {
+		atomic_clear_bit(&adv_flags, ADV_UNDIR_RUNNING);
+		atomic_set_bit(&adv_flags, ADV_UNDIR_SLOW);
+	}
+
+	k_work_submit(&adv_work);
+}
+
+static void adv_connected(struct bt_le_ext_adv *adv,
+			  struct bt_le_ext_adv_connected_info *info)
+{
+	/* The set is stopped, the connection callbacks restart advertising. */
+	atomic_clear_bit(&adv_flags, (adv == adv_dir) ? ADV_DIR_RUNNING : ADV_UNDIR_RUNNING);
+}
+
+static const struct bt_le_ext_adv_cb adv_cb = {
+	.sent = adv_sent,
+	.connected = adv_connected,
+};
+
+static void conn_count(struct bt_conn *conn, void *user_data)
+{
+	struct bt_conn_info info;
+	size_t *count = user_data;
+
+	if (!bt_conn_get_info(conn, &info) && (info.state == BT_CONN_STATE_CONNECTED)) {
+		(*count)++;
+	}
+}
+
+static size_t conn_slots_free(void)
+{
+	size_t count = 0;
+
+	bt_conn_foreach(BT_CONN_TYPE_LE, conn_count, &count);
+
+	return CONN_SLOTS - MIN(count, CONN_SLOTS);
+}
+
+static bool bond_is_connected(const bt_addr_le_t *addr)
+{
+	struct bt_conn *conn = bt_conn_lookup_addr_le(BT_ID_DEFAULT, addr);
+
+	if (!conn) {
+		return false;
+	}
+
+	bt_conn_unref(conn);
+
+	return true;
+}
+
+static void adv_set_stop(struct bt_le_ext_adv *adv, int running_bit)
+{
+	int err;
+
+	if (!atomic_test_and_clear_bit(&adv_flags, running_bit)) {
+		return;
+	}
+
+	err = bt_le_ext_adv_stop(adv);
+	if (err) {
+		printk("Advertising failed to stop (err %d)\n", err);
+	}
+}
+
+static int adv_dir_start(const bt_addr_le_t *addr)
+{
+	struct bt_le_adv_param param =
+		BT_LE_ADV_PARAM_INIT(BT_LE_ADV_OPT_CONNECTABLE | BT_LE_ADV_OPT_DIR_ADDR_RPA,
+				     0, 0, addr);
+	struct bt_le_ext_adv_start_param start = BT_LE_EXT_ADV_START_PARAM_INIT(DIR_ADV_TIMEOUT, 0);
+	int err;
+
+	if (!adv_dir) {
+		err = bt_le_ext_adv_create(&param, &adv_cb, &adv_dir);
+	} else {
+		err = bt_le_ext_adv_update_param(adv_dir, &param);
+	}
+
+	if (err) {
+		return err;
+	}
+
+	err = bt_le_ext_adv_start(adv_dir, &start);
+	if (err) {
+		return err;
+	}
+
+	atomic_set_bit(&adv_flags, ADV_DIR_RUNNING);
+	stats_boot_mark(STATS_BOOT_FIRST_ADV);
+
+	return 0;
+}
+
+/* Start a directed advertising burst to the next bonded host that is not
+ * connected, in the most recently used order.
+ */
+static int adv_dir_next(void)
+{
+	char addr_buf[BT_ADDR_LE_STR_LEN];
+	bt_addr_le_t addr;
+	int err;
+
+	while (!bond_cache_get(atomic_inc(&adv_bond_idx), &addr)) {
+		if (bond_is_connected(&addr)) {
+			continue;
+		}
+
+		bt_addr_le_to_str(&addr, addr_buf, sizeof(addr_buf));
+
+		err = adv_dir_start(&addr);
+		if (err) {
+			printk("Directed advertising to %s failed to start (err %d)\n",
+			       addr_buf, err);
+			continue;
+		}
+
+		printk("Direct advertising to %s started\n", addr_buf);
+		return 0;
+	}
+
+	return -ENOENT;
+}
+
+static int adv_undir_start(void)
+{
+	bool slow = atomic_test_bit(&adv_flags, ADV_UNDIR_SLOW);
+	struct bt_le_adv_param param = BT_LE_ADV_PARAM_INIT(
+		BT_LE_ADV_OPT_CONNECTABLE | UNDIR_ADV_OPT,
+		slow ? BT_GAP_ADV_SLOW_INT_MIN : BT_GAP_ADV_FAST_INT_MIN_1,
+		slow ? BT_GAP_ADV_SLOW_INT_MAX : BT_GAP_ADV_FAST_INT_MAX_1,
+		NULL);
+	struct bt_le_ext_adv_start_param start =
+		BT_LE_EXT_ADV_START_PARAM_INIT(slow ? 0 : UNDIR_ADV_FAST_TIMEOUT, 0);
+	int err;
+
+	err = bt_le_ext_adv_update_param(adv_undir, &param);
+	if (err) {
+		return err;
+	}
+
+	err = bt_le_ext_adv_start(adv_undir, &start);
+	if (err) {
+		return err;
+	}
+
+	atomic_set_bit(&adv_flags, ADV_UNDIR_RUNNING);
+	stats_boot_mark(STATS_BOOT_FIRST_ADV);
+
+	printk("Regular advertising started (%s)\n", slow ? "slow" : "fast");
+
+	return 0;
+}
+
+static void adv_process(struct k_work *work)
+{
+	size_t slots = conn_slots_free();
+	int err;
+
+	if (atomic_test_and_clear_bit(&adv_flags, ADV_REQ_STOP) || !slots) {
+		adv_set_stop(adv_dir, ADV_DIR_RUNNING);
+		adv_set_stop(adv_undir, ADV_UNDIR_RUNNING);
+		return;
+	}
+
+	if (atomic_test_and_clear_bit(&adv_flags, ADV_REQ_RESTART)) {
+		adv_set_stop(adv_dir, ADV_DIR_RUNNING);
+		adv_set_stop(adv_undir, ADV_UNDIR_RUNNING);
+
+		atomic_clear(&adv_bond_idx);
+		atomic_clear_bit(&adv_flags, ADV_DIR_DONE);
+		atomic_clear_bit(&adv_flags, ADV_UNDIR_SLOW);
+	}
+
+	if (!atomic_test_bit(&adv_flags, ADV_DIR_RUNNING) &&
+	    !atomic_test_bit(&adv_flags, ADV_DIR_DONE)) {
+		if (adv_dir_next()) {
+			atomic_set_bit(&adv_flags, ADV_DIR_DONE);
+		}
+	}
+
+	/* Both sets run only if each of them can get a connection. */
+	if (atomic_test_bit(&adv_flags, ADV_DIR_RUNNING) && (slots < 2)) {
+		adv_set_stop(adv_undir, ADV_UNDIR_RUNNING);
+		return;
+	}
+
+	if (!atomic_test_bit(&adv_flags, ADV_UNDIR_RUNNING)) {
+		err = adv_undir_start();
+		if (err) {
+			printk("Advertising failed to start (err %d)\n", err);
+		}
+	}
+}
+
+int advertising_init(void)
+{
+	int err;
+
+	err = bt_le_ext_adv_create(BT_LE_ADV_PARAM(BT_LE_ADV_OPT_CONNECTABLE | UNDIR_ADV_OPT,
+						   BT_GAP_ADV_FAST_INT_MIN_1,
+						   BT_GAP_ADV_FAST_INT_MAX_1, NULL),
+				   &adv_cb, &adv_undir);
+	if (err) {
+		printk("Failed to create the advertising set (err %d)\n", err);
+		return err;
+	}
+
+#if defined(CONFIG_APP_ADV_PHY_LEGACY)
+	err = bt_le_ext_adv_set_data(adv_undir, ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
+#else
+	err = bt_le_ext_adv_set_data(adv_undir, ad, ARRAY_SIZE(ad), NULL, 0);
+#endif
+	if (err) {
+		printk("Failed to set the advertising data (err %d)\n", err);
+	}
+
+	return err;
+}
+
+static void adv_set_delete(struct bt_le_ext_adv **adv)
+{
+	int err;
+
+	if (!*adv) {
+		return;
+	}
+
+	err = bt_le_ext_adv_stop(*adv);
+	if (err) {
+		printk("Advertising failed to stop (err %d)\n", err);
+	}
+
+	err = bt_le_ext_adv_delete(*adv);
+	if (err) {
+		printk("Failed to delete the advertising set (err %d)\n", err);
+	}
+
+	*adv = NULL;
+}
+
+void advertising_deinit(void)
+{
+	struct k_work_sync sync;
+
+	/* No new connection may come in while the hosts are disconnected. */
+	k_work_cancel_sync(&adv_work, &sync);
+	adv_set_delete(&adv_dir);
+	adv_set_delete(&adv_undir);
+	atomic_clear(&adv_flags);
+}
+
+void advertising_start(void)
+{
+	atomic_clear_bit(&adv_flags, ADV_REQ_STOP);
+	atomic_set_bit(&adv_flags, ADV_REQ_RESTART);
+	k_work_submit(&adv_work);
+}
+
+void advertising_stop(void)
+{
+	atomic_clear_bit(&adv_flags, ADV_REQ_RESTART);
+	atomic_set_bit(&adv_flags, ADV_REQ_STOP);
+	k_work_submit(&adv_work);
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef ADVERTISING_H_
+#define ADVERTISING_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Initialize the advertising sets.
+ *
+ *  Must be called once Bluetooth is ready, which with Bluetooth settings
+ *  enabled is after the identity is loaded.
+ *
+ *  @retval 0 if the operation was successful, otherwise a (negative) error code.
+ */
+int advertising_init(void);
+
+/** @brief Stop and delete the advertising sets before Bluetooth is disabled.
+ *
+ *  Call it before disconnecting the hosts, so that they can't reconnect.
+ *  Must be called from a thread other than the system workqueue.
+ */
+void advertising_deinit(void);
+
+/** @brief Start or restart the advertising.
+ *
+ *  Directed advertising goes through the bonded hosts from the most
+ *  recently used one, while undirected advertising keeps the device
+ *  discoverable, at a fast interval first and at a slow one after the
+ *  configured time. Both sets run concurrently as long as there are enough
+ *  free connection slots for them.
+ */
+void advertising_start(void);
+
+/** @brief Stop all advertising sets. */
+void advertising_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADVERTISING_H_ */
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Radio time arbiter.
+ *
+ * Distance Measurement runs in MPSL timeslots that take the radio away
+ * from the HID connections. While the mouse moves, the ranging requests
+ * are metered with a token bucket that refills with the configured share
+ * of the radio time, and the requests it cannot cover are skipped. A
+ * ranging request is bound to the advertising event that triggered it on
+ * both devices, so a skipped request is not queued for later: ranging
+ * continues with the next request the bucket covers. When the mouse is
+ * idle, all requests go through.
+ *
+ * The connection events the controller skipped, because of the timeslots
+ * or anything else, are counted from the SoftDevice Controller QoS
+ * connection event reports.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/hci.h>
+#include <zephyr/sys/atomic.h>
+
+#if defined(CONFIG_APP_AIRTIME_CONN_EVENT_STATS)
+#include <sdc_hci_vs.h>
+#endif
+
+#include "airtime.h"
+#include "stats.h"
+
+/* Ranging credit allowed to build up while the radio is not used for it. */
+#define BUCKET_SIZE_US (CONFIG_APP_AIRTIME_DM_SLOT_US * CONFIG_APP_AIRTIME_DM_BURST)
+
+static struct {
+	struct k_spinlock lock;
+	/* Ranging radio time credit in microseconds. */
+	uint32_t tokens_us;
+	int64_t refill_ticks;
+} bucket = {
+	.tokens_us = BUCKET_SIZE_US,
+};
+
+/* Uptime of the last motion, starting out as idle. */
+static atomic_t motion_time = ATOMIC_INIT(-CONFIG_APP_AIRTIME_MOTION_HOLDOFF_MS);
+
+/* Must be called with the bucket lock held. */
+static void bucket_refill(void)
+{
+	int64_t now = k_uptime_ticks();
+	uint64_t credit_us;
+
+	credit_us = k_ticks_to_us_floor64(now - bucket.refill_ticks) *
+		    CONFIG_APP_AIRTIME_DM_SHARE_PCT / 100;
+	bucket.refill_ticks = now;
+	bucket.tokens_us = MIN(bucket.tokens_us + credit_us, BUCKET_SIZE_US);
+}
+
+static bool motion_active(void)
+{
+	uint32_t elapsed = k_uptime_get_32() - (uint32_t)atomic_get(&motion_time);
+
+	return elapsed < CONFIG_APP_AIRTIME_MOTION_HOLDOFF_MS;
+}
+
+static bool request_allowed(void)
+{
+	k_spinlock_key_t key;
+	bool allowed = true;
+
+	key = k_spin_lock(&bucket.lock);
+
+	bucket_refill();
+
+	if (bucket.tokens_us >= CONFIG_APP_AIRTIME_DM_SLOT_US) {
+		bucket.tokens_us -= CONFIG_APP_AIRTIME_DM_SLOT_US;
+	} else if (motion_active()) {
+		allowed = false;
+	} else {
+		/* Idle, ranging runs at full rate. */
+		bucket.tokens_us = 0;
+	}
+
+	k_spin_unlock(&bucket.lock, key);
+
+	return allowed;
+}
+
+int airtime_dm_request(struct dm_request *req)
+{
+	int err;
+
+	if (!request_allowed()) {
+		stats_airtime_dm_request(true);
+		return -EAGAIN;
+	}
+
+	err = dm_request_add(req);
+	if (!err) {
+		stats_airtime_dm_request(false);
+	}
+
+	return err;
+}
+
+void airtime_motion_mark(void)
+{
+	atomic_set(&motion_time, k_uptime_get_32());
+}
+
+#if defined(CONFIG_APP_AIRTIME_CONN_EVENT_STATS)
+static struct {
+	struct k_spinlock lock;
+	struct {
+		uint16_t handle;
+		uint16_t counter;
+		bool valid;
+	} conn[CONFIG_BT_MAX_CONN];
+} events;
+
+static void conn_event_report(uint16_t handle, uint16_t counter)
+{
+	k_spinlock_key_t key;
+	int free = -1;
+
+	key = k_spin_lock(&events.lock);
+
+	for (size_t i = 0; i < ARRAY_SIZE(events.conn); i++) {
+		if (!events.conn[i].valid) {
+			free = (free < 0) ? i : free;
+			continue;
+		}
+
+		if (events.conn[i].handle == handle) {
+			uint16_t skipped = counter - events.conn[i].counter - 1;
+
+			if (skipped) {
+				stats_airtime_conn_events_skipped(skipped);
+			}
+
+			events.conn[i].counter = counter;
+			k_spin_unlock(&events.lock, key);
+			return;
+		}
+	}
+
+	/* First report of the connection. */
+	if (free >= 0) {
+		events.conn[free].handle = handle;
+		events.conn[free].counter = counter;
+		events.conn[free].valid = true;
+	}
+
+	k_spin_unlock(&events.lock, key);
+}
+
+static bool vs_evt_handler(struct net_buf_simple *buf)
+{
+	const sdc_hci_subevent_vs_qos_conn_event_report_t *evt;
+	uint8_t code;
+
+	code = net_buf_simple_pull_u8(buf);
+	if (code != SDC_HCI_SUBEVENT_VS_QOS_CONN_EVENT_REPORT) {
+		return false;
+	}
+
+	evt = (const void *)buf->data;
+	conn_event_report(sys_le16_to_cpu(evt->conn_handle), sys_le16_to_cpu(evt->event_counter));
+
+	return true;
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	k_spinlock_key_t key;
+	uint16_t handle;
+
+	if (bt_hci_get_conn_handle(conn, &handle)) {
+		return;
+	}
+
+	key = k_spin_lock(&events.lock);
+
+	for (size_t i = 0; i < ARRAY_SIZE(events.conn); i++) {
+		if (events.conn[i].valid && (events.conn[i].handle == handle)) {
+			events.conn[i].valid = false;
+		}
+	}
+
+	k_spin_unlock(&events.lock, key);
+}
+
+BT_CONN_CB_DEFINE(airtime_conn_callbacks) = {
+	.disconnected = disconnected,
+};
+
+static int conn_event_reports_enable(void)
+{
+	sdc_hci_cmd_vs_qos_conn_event_report_enable_t *cmd;
+	struct net_buf *buf;
+	int err;
+
+	err = bt_hci_register_vnd_evt_cb(vs_evt_handler);
+	if (err) {
+		return err;
+	}
+
+	buf = bt_hci_cmd_create(SDC_HCI_OPCODE_CMD_VS_QOS_CONN_EVENT_REPORT_ENABLE, sizeof(*cmd));
+	if (!buf) {
+		return -ENOBUFS;
+	}
+
+	cmd = net_buf_add(buf, sizeof(*cmd));
+	cmd->enable = 1;
+
+	return bt_hci_cmd_send_sync(SDC_HCI_OPCODE_CMD_VS_QOS_CONN_EVENT_REPORT_ENABLE, buf, NULL);
+}
+#endif /* defined(CONFIG_APP_AIRTIME_CONN_EVENT_STATS) */
+
+int airtime_init(void)
+{
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&bucket.lock);
+	bucket.refill_ticks = k_uptime_ticks();
+	k_spin_unlock(&bucket.lock, key);
+
+#if defined(CONFIG_APP_AIRTIME_CONN_EVENT_STATS)
+	int err;
+
+	/* The controller forgets the setting when Bluetooth is disabled. */
+	err = conn_event_reports_enable();
+	if (err) {
+		printk("Failed to enable the connection event reports (err %d)\n", err);
+		return err;
+	}
+#endif
+
+	return 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef AIRTIME_H_
+#define AIRTIME_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <dm.h>
+
+#if defined(CONFIG_APP_AIRTIME)
+
+/** @brief Initialize the radio time arbiter.
+ *
+ *  Must be called once Bluetooth is enabled.
+ *
+ *  @retval 0 if the operation was successful, otherwise a (negative) error code.
+ */
+int airtime_init(void);
+
+/** @brief Request a Distance Measurement timeslot.
+ *
+ *  While the mouse moves, the ranging timeslots are limited to the
+ *  configured share of the radio time and the requests over it are
+ *  dropped, not queued: a request is bound to the advertising event that
+ *  triggered it, ranging continues with the next allowed request. When
+ *  the mouse is idle, the requests are passed on at once.
+ *
+ *  @param req Distance Measurement request.
+ *
+ *  @retval 0 if the request was added.
+ *  @retval -EAGAIN if the request was dropped to keep the radio time share.
+ *  @retval Otherwise a (negative) error code of dm_request_add().
+ */
+int airtime_dm_request(struct dm_request *req);
+
+/** @brief Report mouse motion.
+ *
+ *  Can be called from any context.
+ */
+void airtime_motion_mark(void);
+
+#else
+
+static inline int airtime_init(void) { return 0; }
+static inline int airtime_dm_request(struct dm_request *req) { return dm_request_add(req); }
+static inline void airtime_motion_mark(void) {}
+
+#endif /* defined(CONFIG_APP_AIRTIME) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AIRTIME_H_ */
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Azimuth and elevation source.
+ *
+ * A timer running at the source rate submits a work item that takes a
+ * sample from the selected source and hands it to the subscribers, each
+ * of them at most once per its own interval. The optional simulated
+ * source, for testing, circles around at a constant azimuth speed while
+ * its elevation swings up and down. An AoA estimator provides its own
+ * source without changes to the subscribers.
+ */
+
+#include <math.h>
+#include <zephyr/kernel.h>
+#include <zephyr/random/random.h>
+#include <zephyr/shell/shell.h>
+#include <stdlib.h>
+
+#include "angle.h"
+#include "stats.h"
+
+static const struct angle_source *source;
+static uint32_t rate_hz;
+
+static sys_slist_t subs = SYS_SLIST_STATIC_INIT(&subs);
+static K_MUTEX_DEFINE(angle_mtx);
+
+static void angle_work_handler(struct k_work *work)
+{
+	struct angle_sample sample;
+	struct angle_sub *sub;
+	int64_t now;
+	uint32_t slack_ms;
+
+	k_mutex_lock(&angle_mtx, K_FOREVER);
+
+	if (!source || !rate_hz || source->sample_get(&sample)) {
+		k_mutex_unlock(&angle_mtx);
+		return;
+	}
+
+	stats_angle_sample();
+
+	/* Samples come with some jitter, let a subscriber interval that
+	 * matches the source period take every sample.
+	 */
+	slack_ms = MSEC_PER_SEC / rate_hz / 2;
+	now = k_uptime_get();
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&subs, sub, node) {
+		if (now + slack_ms < sub->next_time) {
+			sub->skipped++;
+			continue;
+		}
+
+		sub->next_time += sub->interval_ms;
+		if (sub->next_time + slack_ms <= now) {
+			sub->next_time = now + sub->interval_ms;
+		}
+
+		sub->cb(sub, &sample);
+	}
+
+	k_mutex_unlock(&angle_mtx);
+}
+
+static K_WORK_DEFINE(angle_work, angle_work_handler);
+
+static void angle_timer_handler(struct k_timer *timer)
+{
+	k_work_submit(&angle_work);
+}
+
+static K_TIMER_DEFINE(angle_timer, angle_timer_handler, NULL);
+
+#if defined(CONFIG_APP_ANGLE_SIM)
+#define SIM_ELEVATION_MAX  45
+#define SIM_NOISE          CONFIG_APP_ANGLE_SIM_NOISE_DEG
+
+static int sim_noise_get(void)
+{
+	return (int)(sys_rand32_get() % (2 * SIM_NOISE + 1)) - SIM_NOISE;
+}
+
+static int sim_sample_get(struct angle_sample *sample)
+{
+	static const bt_addr_le_t sim_addr = {
+		.type = BT_ADDR_LE_RANDOM,
+		.a.val = {0xFF, 0xEE, 0xDD, 0xCC, 0xBB, 0xAA},
+	};
+	const uint32_t elevation_period_ms = CONFIG_APP_ANGLE_SIM_ELEVATION_PERIOD_S * MSEC_PER_SEC;
+	int64_t now = k_uptime_get();
+	float phase = (float)(now % elevation_period_ms) / elevation_period_ms;
+	int azimuth = (now * CONFIG_APP_ANGLE_SIM_AZIMUTH_DPS / MSEC_PER_SEC) % 360;
+	int elevation = (int)(SIM_ELEVATION_MAX * sinf(2 * (float)M_PI * phase));
+
+	bt_addr_le_copy(&sample->addr, &sim_addr);
+	sample->azimuth = (azimuth + sim_noise_get() + 360) % 360;
+	sample->elevation = CLAMP(elevation + sim_noise_get(), -90, 90);
+	sample->quality = ANGLE_QUALITY_OK;
+
+	return 0;
+}
+
+static const struct angle_source sim_source = {
+	.sample_get = sim_sample_get,
+};
+#endif /* defined(CONFIG_APP_ANGLE_SIM) */
+
+void angle_source_set(const struct angle_source *new_source)
+{
+	k_mutex_lock(&angle_mtx, K_FOREVER);
+	source = new_source;
+	k_mutex_unlock(&angle_mtx);
+}
+
+void angle_rate_set(uint32_t new_rate_hz)
+{
+	k_mutex_lock(&angle_mtx, K_FOREVER);
+
+	rate_hz = new_rate_hz;
+	if (rate_hz) {
+		k_timer_start(&angle_timer, K_NO_WAIT, K_USEC(USEC_PER_SEC / rate_hz));
+	} else {
+		k_timer_stop(&angle_timer);
+	}
+
+	k_mutex_unlock(&angle_mtx);
+}
+
+int angle_subscribe(struct angle_sub *sub)
+{
+	if (!sub || !sub->cb) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&angle_mtx, K_FOREVER);
+	sub->skipped = 0;
+	sub->next_time = k_uptime_get();
+	sys_slist_append(&subs, &sub->node);
+	k_mutex_unlock(&angle_mtx);
+
+	return 0;
+}
+
+void angle_unsubscribe(struct angle_sub *sub)
+{
+	k_mutex_lock(&angle_mtx, K_FOREVER);
+	sys_slist_find_and_remove(&subs, &sub->node);
+	k_mutex_unlock(&angle_mtx);
+}
+
+int angle_init(void)
+{
+#if defined(CONFIG_APP_ANGLE_SIM)
+	angle_source_set(&sim_source);
+#endif
+
+	angle_rate_set(CONFIG_APP_ANGLE_RATE_HZ);
+
+	return 0;
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_hid_angle(const struct shell *sh, size_t argc, char **argv)
+{
+	struct angle_sub *sub;
+	size_t i = 0;
+	int err = 0;
+
+	if (argc > 1) {
+		unsigned long rate = shell_strtoul(argv[1], 0, &err);
+
+		if (err || (rate > CONFIG_APP_ANGLE_RATE_MAX_HZ)) {
+			shell_error(sh, "Invalid rate, from 0 to %u Hz",
+				    CONFIG_APP_ANGLE_RATE_MAX_HZ);
+			return -EINVAL;
+		}
+
+		angle_rate_set(rate);
+	}
+
+	k_mutex_lock(&angle_mtx, K_FOREVER);
+
+	shell_print(sh, "angle: %s source, rate %u Hz", source ? "active" : "no", rate_hz);
+	SYS_SLIST_FOR_EACH_CONTAINER(&subs, sub, node) {
+		shell_print(sh, "subscriber %zu: interval %u ms, skipped %u", i++,
+			    sub->interval_ms, sub->skipped);
+	}
+
+	k_mutex_unlock(&angle_mtx);
+
+	return 0;
+}
+
+SHELL_SUBCMD_ADD((hid), angle, NULL, "Show or set the angle source rate [rate_hz]",
+		 cmd_hid_angle, 1, 1);
+#endif /* defined(CONFIG_SHELL) */
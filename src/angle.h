@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef ANGLE_H_
+#define ANGLE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/addr.h>
+
+/** Angle estimate quality. */
+enum angle_quality {
+	ANGLE_QUALITY_OK,
+	ANGLE_QUALITY_POOR,
+	ANGLE_QUALITY_DO_NOT_USE,
+};
+
+/** Azimuth and elevation of a tracked device. */
+struct angle_sample {
+	/** Address of the tracked device. */
+	bt_addr_le_t addr;
+	/** Azimuth in degrees, from 0 to 359. */
+	uint16_t azimuth;
+	/** Elevation in degrees, from -90 to 90. */
+	int8_t elevation;
+	/** Estimate quality. */
+	enum angle_quality quality;
+};
+
+/** Angle source, such as a trajectory simulation or an AoA estimator. */
+struct angle_source {
+	/** @brief Get the current angles.
+	 *
+	 *  Called from the system workqueue at the source rate.
+	 *
+	 *  @param sample Sample to fill.
+	 *
+	 *  @retval 0 if a new sample is available, otherwise a (negative) error code.
+	 */
+	int (*sample_get)(struct angle_sample *sample);
+};
+
+struct angle_sub;
+
+/** @brief Angle sample handler.
+ *
+ *  Called from the system workqueue.
+ *
+ *  @param sub Subscription.
+ *  @param sample Angle sample.
+ */
+typedef void (*angle_cb_t)(struct angle_sub *sub, const struct angle_sample *sample);
+
+/** Angle sample subscription. */
+struct angle_sub {
+	/** Sample handler. */
+	angle_cb_t cb;
+	/** Minimum interval between two samples given to the handler in
+	 *  milliseconds, the samples in between are skipped.
+	 */
+	uint32_t interval_ms;
+	/** Number of samples skipped by the rate limit. */
+	uint32_t skipped;
+	int64_t next_time;
+	sys_snode_t node;
+};
+
+#if defined(CONFIG_APP_ANGLE)
+
+/** @brief Initialize the angle source.
+ *
+ *  Selects the trajectory simulation if it is enabled and starts
+ *  sampling at CONFIG_APP_ANGLE_RATE_HZ.
+ *
+ *  @retval 0 if the operation was successful, otherwise a (negative) error code.
+ */
+int angle_init(void);
+
+/** @brief Select the angle source.
+ *
+ *  @param source Angle source, NULL to stop producing samples.
+ */
+void angle_source_set(const struct angle_source *source);
+
+/** @brief Set the sampling rate of the angle source.
+ *
+ *  @param rate_hz Rate in Hz, 0 to stop sampling.
+ */
+void angle_rate_set(uint32_t rate_hz);
+
+/** @brief Subscribe to the angle samples.
+ *
+ *  @param sub Subscription, must stay valid until unsubscribed.
+ *
+ *  @retval 0 if the operation was successful, otherwise a (negative) error code.
+ */
+int angle_subscribe(struct angle_sub *sub);
+
+/** @brief Unsubscribe from the angle samples.
+ *
+ *  @param sub Subscription.
+ */
+void angle_unsubscribe(struct angle_sub *sub);
+
+#else
+
+static inline int angle_init(void) { return 0; }
+static inline void angle_source_set(const struct angle_source *source) {}
+static inline void angle_rate_set(uint32_t rate_hz) {}
+static inline int angle_subscribe(struct angle_sub *sub) { return -ENOTSUP; }
+static inline void angle_unsubscribe(struct angle_sub *sub) {}
+
+#endif /* defined(CONFIG_APP_ANGLE) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ANGLE_H_ */
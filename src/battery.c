@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Battery level measurement.
+ *
+ * Samples the battery voltage through the ADC channel of the zephyr,user
+ * devicetree node, or a simulated discharge when the board has none, and
+ * filters it. The Battery Service level is only updated, and therefore
+ * notified, when it changes by a configured step or when the last report
+ * is older than the report timeout.
+ */
+
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/adc.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/services/bas.h>
+#include <zephyr/shell/shell.h>
+
+#if defined(CONFIG_ADC_EMUL)
+#include <zephyr/drivers/adc/adc_emul.h>
+#endif
+
+#include "battery.h"
+
+#define BATTERY_ADC DT_NODE_HAS_PROP(DT_PATH(zephyr_user), io_channels)
+
+/* The filtered voltage moves 1/2^N towards each new sample. */
+#define FILTER_SHIFT            2
+
+/* Simulated discharge from full to empty, then starting over. */
+#define SIM_FULL_MV             3000
+#define SIM_EMPTY_MV            2000
+#define SIM_DRAIN_MV_PER_MIN    10
+
+struct level_point {
+	int32_t mv;
+	uint8_t level;
+};
+
+/* Discharge curve of a lithium coin cell, from full to empty. */
+static const struct level_point level_curve[] = {
+	{ 3000, 100 },
+	{ 2900,  80 },
+	{ 2800,  60 },
+	{ 2700,  40 },
+	{ 2600,  20 },
+	{ 2400,   5 },
+	{ 2000,   0 },
+};
+
+#if BATTERY_ADC
+static const struct adc_dt_spec adc_chan = ADC_DT_SPEC_GET(DT_PATH(zephyr_user));
+#endif
+
+static struct {
+	int32_t sample_mv;
+	/* Filtered voltage, scaled by 2^FILTER_SHIFT. */
+	int32_t filtered;
+	uint8_t level;
+	uint8_t reported_level;
+	int64_t reported_time;
+	bool reported;
+} battery;
+
+static void battery_work_handler(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(battery_work, battery_work_handler);
+
+static int32_t sim_mv_get(void)
+{
+	int64_t drained = (k_uptime_get() / MSEC_PER_SEC) * SIM_DRAIN_MV_PER_MIN / 60;
+
+	return SIM_FULL_MV - (drained % (SIM_FULL_MV - SIM_EMPTY_MV));
+}
+
+#if defined(CONFIG_ADC_EMUL) && BATTERY_ADC
+static int adc_emul_value(const struct device *dev, unsigned int chan, void *data,
+			  uint32_t *result)
+{
+	*result = sim_mv_get();
+
+	return 0;
+}
+#endif
+
+static int sample_get(int32_t *mv)
+{
+#if BATTERY_ADC
+	int16_t raw;
+	struct adc_sequence sequence = {
+		.buffer = &raw,
+		.buffer_size = sizeof(raw),
+	};
+	int err;
+
+	err = adc_sequence_init_dt(&adc_chan, &sequence);
+	if (err) {
+		return err;
+	}
+
+	err = adc_read_dt(&adc_chan, &sequence);
+	if (err) {
+		return err;
+	}
+
+	*mv = raw;
+
+	return adc_raw_to_millivolts_dt(&adc_chan, mv);
+#else
+	*mv = sim_mv_get();
+
+	return 0;
+#endif
+}
+
+static uint8_t level_get(int32_t mv)
+{
+	const struct level_point *pb = &level_curve[0];
+
+	if (mv >= pb->mv) {
+		return pb->level;
+	}
+
+	for (size_t i = 1; i < ARRAY_SIZE(level_curve); i++) {
+		const struct level_point *pa = &level_curve[i];
+
+		if (mv >= pa->mv) {
+			/* Linear interpolation between the two points. */
+			return pa->level + ((pb->level - pa->level) * (mv - pa->mv)) /
+					   (pb->mv - pa->mv);
+		}
+
+		pb = pa;
+	}
+
+	return 0;
+}
+
+static bool report_due(uint8_t level, int64_t now)
+{
+	if (!battery.reported) {
+		return true;
+	}
+
+	if (abs(level - battery.reported_level) >= CONFIG_APP_BATTERY_REPORT_STEP) {
+		return true;
+	}
+
+	return (now - battery.reported_time) >=
+	       (CONFIG_APP_BATTERY_REPORT_TIMEOUT_S * MSEC_PER_SEC);
+}
+
+static void battery_work_handler(struct k_work *work)
+{
+	int64_t now = k_uptime_get();
+	int32_t mv;
+	int err;
+
+	k_work_reschedule(&battery_work, K_SECONDS(CONFIG_APP_BATTERY_SAMPLE_INTERVAL_S));
+
+	err = sample_get(&mv);
+	if (err) {
+		printk("Battery sampling failed (err %d)\n", err);
+		return;
+	}
+
+	battery.sample_mv = mv;
+
+	if (!battery.filtered) {
+		battery.filtered = mv << FILTER_SHIFT;
+	} else {
+		battery.filtered += mv - (battery.filtered >> FILTER_SHIFT);
+	}
+
+	battery.level = level_get(battery.filtered >> FILTER_SHIFT);
+
+	/* Bluetooth is disabled while suspended, report once it is back. */
+	if (!bt_is_ready() || !report_due(battery.level, now)) {
+		return;
+	}
+
+	/* Setting the level notifies the subscribed hosts. */
+	(void)bt_bas_set_battery_level(battery.level);
+
+	battery.reported_level = battery.level;
+	battery.reported_time = now;
+	battery.reported = true;
+}
+
+int battery_init(void)
+{
+#if BATTERY_ADC
+	int err;
+
+	if (!adc_is_ready_dt(&adc_chan)) {
+		printk("Battery ADC is not ready\n");
+		return -ENODEV;
+	}
+
+	err = adc_channel_setup_dt(&adc_chan);
+	if (err) {
+		printk("Battery ADC channel setup failed (err %d)\n", err);
+		return err;
+	}
+
+#if defined(CONFIG_ADC_EMUL)
+	err = adc_emul_value_func_set(adc_chan.dev, adc_chan.channel_id, adc_emul_value, NULL);
+	if (err) {
+		return err;
+	}
+#endif
+#endif /* BATTERY_ADC */
+
+	k_work_reschedule(&battery_work, K_NO_WAIT);
+
+	return 0;
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_hid_battery(const struct shell *sh, size_t argc, char **argv)
+{
+	shell_print(sh, "battery: sample %d mV, filtered %d mV, level %u%%",
+		    battery.sample_mv, battery.filtered >> FILTER_SHIFT, battery.level);
+	shell_print(sh, "reported: level %u%%, %lld s ago", battery.reported_level,
+		    (k_uptime_get() - battery.reported_time) / MSEC_PER_SEC);
+
+	return 0;
+}
+
+SHELL_SUBCMD_ADD((hid), battery, NULL, "Show the battery measurement", cmd_hid_battery, 1, 0);
+#endif /* defined(CONFIG_SHELL) */
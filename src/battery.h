@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef BATTERY_H_
+#define BATTERY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(CONFIG_APP_BATTERY)
+
+/** @brief Start the battery level measurement.
+ *
+ *  The battery voltage is sampled periodically in the system workqueue,
+ *  filtered, and the Battery Service level is updated only when it changed
+ *  by the configured step or when the report timeout expired.
+ *
+ *  @retval 0 if the operation was successful, otherwise a (negative) error code.
+ */
+int battery_init(void);
+
+#else
+
+static inline int battery_init(void) { return 0; }
+
+#endif /* defined(CONFIG_APP_BATTERY) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BATTERY_H_ */
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Bonded host cache.
+ *
+ * Keeps the identity addresses of the bonded hosts in RAM, ordered from
+ * the most to the least recently used one, so the directed advertising
+ * does not have to enumerate the settings storage each time it starts.
+ * The bond storage has no order, so the order is saved in a settings
+ * entry of its own and restored after a reboot.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/shell/shell.h>
+#include <string.h>
+
+#include "bond_cache.h"
+
+#define ORDER_SETTINGS_KEY      "app/bonds/order"
+/* The order changes in bursts on reconnections, save it once they settle. */
+#define ORDER_SAVE_DELAY_MS     1000
+
+static struct {
+	struct k_spinlock lock;
+	bt_addr_le_t addr[CONFIG_BT_MAX_PAIRED];
+	size_t count;
+} cache;
+
+#if defined(CONFIG_SETTINGS)
+/* Order loaded from the settings, applied by bond_cache_load(). */
+static struct {
+	bt_addr_le_t addr[CONFIG_BT_MAX_PAIRED];
+	size_t count;
+} stored;
+
+static int order_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+	ssize_t size;
+
+	if (!settings_name_steq(name, "order", NULL)) {
+		return -ENOENT;
+	}
+
+	size = read_cb(cb_arg, stored.addr, MIN(len, sizeof(stored.addr)));
+	if (size < 0) {
+		return size;
+	}
+
+	stored.count = size / sizeof(stored.addr[0]);
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(bond_cache, "app/bonds", NULL, order_set, NULL, NULL);
+
+static void order_save(struct k_work *work)
+{
+	bt_addr_le_t addr[CONFIG_BT_MAX_PAIRED];
+	k_spinlock_key_t key;
+	size_t count;
+	int err;
+
+	key = k_spin_lock(&cache.lock);
+	count = cache.count;
+	memcpy(addr, cache.addr, count * sizeof(addr[0]));
+	k_spin_unlock(&cache.lock, key);
+
+	err = settings_save_one(ORDER_SETTINGS_KEY, addr, count * sizeof(addr[0]));
+	if (err) {
+		printk("Failed to save the bond order (err %d)\n", err);
+	}
+}
+
+static K_WORK_DELAYABLE_DEFINE(order_save_work, order_save);
+
+static void order_changed(void)
+{
+	k_work_schedule(&order_save_work, K_MSEC(ORDER_SAVE_DELAY_MS));
+}
+#else
+static void order_changed(void) {}
+#endif /* defined(CONFIG_SETTINGS) */
+
+/* Must be called with the cache lock held. */
+static int cache_find(const bt_addr_le_t *addr)
+{
+	for (size_t i = 0; i < cache.count; i++) {
+		if (!bt_addr_le_cmp(&cache.addr[i], addr)) {
+			return i;
+		}
+	}
+
+	return -ENOENT;
+}
+
+/* Must be called with the cache lock held. */
+static void cache_remove(size_t idx)
+{
+	memmove(&cache.addr[idx], &cache.addr[idx + 1],
+		(cache.count - idx - 1) * sizeof(cache.addr[0]));
+	cache.count--;
+}
+
+/* Must be called with the cache lock held. */
+static void cache_insert_front(const bt_addr_le_t *addr)
+{
+	int idx = cache_find(addr);
+
+	if (idx >= 0) {
+		cache_remove(idx);
+	} else if (cache.count == ARRAY_SIZE(cache.addr)) {
+		/* The stack replaced the least recently used bond. */
+		cache.count--;
+	}
+
+	memmove(&cache.addr[1], &cache.addr[0], cache.count * sizeof(cache.addr[0]));
+	bt_addr_le_copy(&cache.addr[0], addr);
+	cache.count++;
+}
+
+static void bond_add(const struct bt_bond_info *info, void *user_data)
+{
+	if (cache.count < ARRAY_SIZE(cache.addr)) {
+		bt_addr_le_copy(&cache.addr[cache.count++], &info->addr);
+	}
+}
+
+static void pairing_complete(struct bt_conn *conn, bool bonded)
+{
+	k_spinlock_key_t key;
+
+	if (!bonded) {
+		return;
+	}
+
+	key = k_spin_lock(&cache.lock);
+	cache_insert_front(bt_conn_get_dst(conn));
+	k_spin_unlock(&cache.lock, key);
+
+	order_changed();
+}
+
+static void bond_deleted(uint8_t id, const bt_addr_le_t *peer)
+{
+	k_spinlock_key_t key;
+	int idx;
+
+	if (id != BT_ID_DEFAULT) {
+		return;
+	}
+
+	key = k_spin_lock(&cache.lock);
+	idx = cache_find(peer);
+	if (idx >= 0) {
+		cache_remove(idx);
+	}
+	k_spin_unlock(&cache.lock, key);
+
+	if (idx >= 0) {
+		order_changed();
+	}
+}
+
+static struct bt_conn_auth_info_cb bond_cache_auth_info_cb = {
+	.pairing_complete = pairing_complete,
+	.bond_deleted = bond_deleted,
+};
+
+int bond_cache_load(void)
+{
+	static bool registered;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&cache.lock);
+	cache.count = 0;
+	bt_foreach_bond(BT_ID_DEFAULT, bond_add, NULL);
+#if defined(CONFIG_SETTINGS)
+	/* Move the bonds of the saved order to the front, in that order. The
+	 * bonds missing from it are the least recently used ones.
+	 */
+	for (size_t i = stored.count; i > 0; i--) {
+		if (cache_find(&stored.addr[i - 1]) >= 0) {
+			cache_insert_front(&stored.addr[i - 1]);
+		}
+	}
+#endif
+	k_spin_unlock(&cache.lock, key);
+
+	if (registered) {
+		return 0;
+	}
+
+	registered = true;
+
+	return bt_conn_auth_info_cb_register(&bond_cache_auth_info_cb);
+}
+
+void bond_cache_touch(const bt_addr_le_t *addr)
+{
+	k_spinlock_key_t key;
+	bool changed;
+
+	key = k_spin_lock(&cache.lock);
+	/* Nothing changes for the most recently used host. */
+	changed = (cache_find(addr) > 0);
+	if (changed) {
+		cache_insert_front(addr);
+	}
+	k_spin_unlock(&cache.lock, key);
+
+	if (changed) {
+		order_changed();
+	}
+}
+
+int bond_cache_get(size_t idx, bt_addr_le_t *addr)
+{
+	k_spinlock_key_t key;
+	int err = 0;
+
+	key = k_spin_lock(&cache.lock);
+	if (idx < cache.count) {
+		bt_addr_le_copy(addr, &cache.addr[idx]);
+	} else {
+		err = -ENOENT;
+	}
+	k_spin_unlock(&cache.lock, key);
+
+	return err;
+}
+
+#if defined(CONFIG_SHELL)
+static int cmd_hid_bonds(const struct shell *sh, size_t argc, char **argv)
+{
+	char addr_str[BT_ADDR_LE_STR_LEN];
+	bt_addr_le_t addr;
+
+	for (size_t i = 0; !bond_cache_get(i, &addr); i++) {
+		bt_addr_le_to_str(&addr, addr_str, sizeof(addr_str));
+		shell_print(sh, "%zu: %s", i, addr_str);
+	}
+
+	return 0;
+}
+
+SHELL_SUBCMD_ADD((hid), bonds, NULL, "List the bonded hosts, most recently used first",
+		 cmd_hid_bonds, 1, 0);
+#endif /* defined(CONFIG_SHELL) */
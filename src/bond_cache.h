@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef BOND_CACHE_H_
+#define BOND_CACHE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <errno.h>
+#include <zephyr/bluetooth/addr.h>
+
+#if defined(CONFIG_BT_DIRECTED_ADVERTISING)
+
+/** @brief Fill the bond cache from the stored bonds.
+ *
+ *  Must be called after the settings are loaded, which restore the saved
+ *  most recently used order. The cache is then kept in sync through the
+ *  pairing and bond deletion callbacks.
+ *
+ *  @retval 0 if the operation was successful, otherwise a (negative) error code.
+ */
+int bond_cache_load(void);
+
+/** @brief Mark a bonded host as the most recently used one.
+ *
+ *  Addresses that are not bonded are ignored.
+ *
+ *  @param addr Identity address of the host.
+ */
+void bond_cache_touch(const bt_addr_le_t *addr);
+
+/** @brief Get a bonded host address by its position in the cache.
+ *
+ *  The cache is ordered from the most to the least recently used host.
+ *
+ *  @param idx Position in the cache.
+ *  @param addr Address to fill.
+ *
+ *  @retval 0 if the operation was successful.
+ *  @retval -ENOENT if there is no bond at the position.
+ */
+int bond_cache_get(size_t idx, bt_addr_le_t *addr);
+
+#else
+
+static inline int bond_cache_load(void) { return 0; }
+static inline void bond_cache_touch(const bt_addr_le_t *addr) {}
+static inline int bond_cache_get(size_t idx, bt_addr_le_t *addr) { return -ENOENT; }
+
+#endif /* defined(CONFIG_BT_DIRECTED_ADVERTISING) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BOND_CACHE_H_ */
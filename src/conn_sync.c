@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Connection event synchronization.
+ *
+ * Runs a timer with the period of the connection interval of one
+ * connection and re-phases it each time a notification completes, which
+ * happens right after the connection event that carried it. The timer
+ * therefore fires a lead time before every predicted connection event,
+ * which is when the motion should be sampled to be as fresh as possible
+ * at transmission.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+
+#include "conn_sync.h"
+
+static struct {
+	conn_sync_handler_t handler;
+	struct bt_conn *conn;
+	uint32_t interval_us;
+	uint32_t anchor;
+} sync;
+
+static void sync_timer_handler(struct k_timer *timer)
+{
+	if (sync.handler) {
+		sync.handler();
+	}
+}
+
+static K_TIMER_DEFINE(sync_timer, sync_timer_handler, NULL);
+
+static void sync_phase_set(uint32_t delay_us)
+{
+	k_timer_start(&sync_timer, K_USEC(delay_us), K_USEC(sync.interval_us));
+}
+
+static void sync_start(struct bt_conn *conn)
+{
+	struct bt_conn_info info;
+	int err;
+
+	err = bt_conn_get_info(conn, &info);
+	if (err || (info.state != BT_CONN_STATE_CONNECTED)) {
+		return;
+	}
+
+	if (sync.conn != conn) {
+		if (sync.conn) {
+			bt_conn_unref(sync.conn);
+		}
+		sync.conn = bt_conn_ref(conn);
+	}
+
+	/* Connection interval is given in 1.25 ms units. */
+	sync.interval_us = info.le.interval * 1250U;
+	sync.anchor = k_cycle_get_32();
+
+	/* Free run until the first notification gives the event phase. */
+	sync_phase_set(sync.interval_us);
+}
+
+static void sync_stop(void)
+{
+	k_timer_stop(&sync_timer);
+
+	if (sync.conn) {
+		bt_conn_unref(sync.conn);
+		sync.conn = NULL;
+	}
+}
+
+static void conn_find(struct bt_conn *conn, void *user_data)
+{
+	struct bt_conn **found = user_data;
+
+	if (!*found && (conn != sync.conn)) {
+		*found = conn;
+	}
+}
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+	if (!err && !sync.conn) {
+		sync_start(conn);
+	}
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	struct bt_conn *next = NULL;
+
+	if (conn != sync.conn) {
+		return;
+	}
+
+	/* Follow the next connection, if there is one. */
+	bt_conn_foreach(BT_CONN_TYPE_LE, conn_find, &next);
+
+	sync_stop();
+
+	if (next) {
+		sync_start(next);
+	}
+}
+
+static void le_param_updated(struct bt_conn *conn, uint16_t interval,
+			     uint16_t latency, uint16_t timeout)
+{
+	if (conn == sync.conn) {
+		sync_start(conn);
+	}
+}
+
+BT_CONN_CB_DEFINE(conn_sync_callbacks) = {
+	.connected = connected,
+	.disconnected = disconnected,
+	.le_param_updated = le_param_updated,
+};
+
+void conn_sync_init(conn_sync_handler_t handler)
+{
+	sync.handler = handler;
+}
+
+bool conn_sync_active(void)
+{
+	return sync.conn != NULL;
+}
+
+void conn_sync_tx_complete(struct bt_conn *conn)
+{
+	uint32_t now = k_cycle_get_32();
+	uint32_t lead_us = MIN(CONFIG_APP_CONN_SYNC_LEAD_US, sync.interval_us);
+
+	if ((conn != sync.conn) || !sync.interval_us) {
+		return;
+	}
+
+	/* All notifications of one event complete together, only the first
+	 * one of an event is used as the anchor.
+	 */
+	if (k_cyc_to_us_floor32(now - sync.anchor) < (sync.interval_us / 2)) {
+		return;
+	}
+
+	sync.anchor = now;
+	sync_phase_set(sync.interval_us - lead_us);
+}
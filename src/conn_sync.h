@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CONN_SYNC_H_
+#define CONN_SYNC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr/bluetooth/conn.h>
+
+/** @brief Connection event trigger handler.
+ *
+ *  Called from an interrupt context a configured lead time before the
+ *  predicted connection event.
+ */
+typedef void (*conn_sync_handler_t)(void);
+
+#if defined(CONFIG_APP_CONN_SYNC)
+
+/** @brief Initialize the connection event synchronization.
+ *
+ *  @param handler Trigger handler.
+ */
+void conn_sync_init(conn_sync_handler_t handler);
+
+/** @brief Check if the trigger follows a connection.
+ *
+ *  @retval true if the trigger runs, otherwise false.
+ */
+bool conn_sync_active(void);
+
+/** @brief Report a notification completion.
+ *
+ *  A notification completes right after the connection event in which
+ *  it was sent, which anchors the prediction of the next events.
+ *
+ *  @param conn Connection the notification was sent on.
+ */
+void conn_sync_tx_complete(struct bt_conn *conn);
+
+#else
+
+static inline void conn_sync_init(conn_sync_handler_t handler) {}
+static inline bool conn_sync_active(void) { return false; }
+static inline void conn_sync_tx_complete(struct bt_conn *conn) {}
+
+#endif /* defined(CONFIG_APP_CONN_SYNC) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONN_SYNC_H_ */
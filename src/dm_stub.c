@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Distance Measurement stubs for targets without the MPSL timeslot API,
+ * such as the nrf52_bsim simulated board.
+ */
+
+#include <errno.h>
+#include <dm.h>
+
+int dm_init(struct dm_init_param *init_param)
+{
+	return -ENOTSUP;
+}
+
+int dm_request_add(struct dm_request *req)
+{
+	return -ENOTSUP;
+}
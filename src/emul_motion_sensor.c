@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Emulated optical motion sensor.
+ *
+ * Stands in for an optical sensor driver: at every sample period it
+ * performs what would be a motion-burst read and reports the motion
+ * through the input subsystem. The motion follows a smoothed random
+ * velocity, so the reports look like a hand moving the mouse, with
+ * fractional counts carried between samples like a real sensor does.
+ */
+
+#define DT_DRV_COMPAT nordic_emul_motion_sensor
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/input/input.h>
+#include <zephyr/random/random.h>
+#include <zephyr/shell/shell.h>
+#include <string.h>
+
+#include "emul_motion_sensor.h"
+
+/* Number of samples after which a new target velocity is chosen. */
+#define TARGET_PERIOD           256
+/* Velocity filter, the velocity moves 1/2^N towards the target per sample. */
+#define VELOCITY_FILTER_SHIFT   4
+/* Fixed point shift of the per-sample motion. */
+#define MOTION_SHIFT            8
+
+#define SAMPLE_RATE_MAX_HZ      8000
+
+struct emul_motion_config {
+	uint32_t rate_hz;
+	uint32_t speed;
+	bool autostart;
+};
+
+struct emul_motion_data {
+	const struct device *dev;
+	struct k_timer timer;
+	uint32_t rate_hz;
+	int32_t speed;
+	uint32_t samples;
+	int32_t target_x;
+	int32_t target_y;
+	int32_t vel_x;
+	int32_t vel_y;
+	int32_t rem_x;
+	int32_t rem_y;
+};
+
+static int32_t target_get(int32_t speed)
+{
+	return (int32_t)(sys_rand32_get() % (2 * speed + 1)) - speed;
+}
+
+/* Counts moved during one sample at a velocity in counts per second. */
+static int16_t motion_get(int32_t vel, uint32_t rate_hz, int32_t *rem)
+{
+	int32_t value = ((vel << MOTION_SHIFT) / (int32_t)rate_hz) + *rem;
+	int32_t out = value >> MOTION_SHIFT;
+
+	*rem = value - (out << MOTION_SHIFT);
+
+	return out;
+}
+
+static void emul_motion_timer_handler(struct k_timer *timer)
+{
+	struct emul_motion_data *data = CONTAINER_OF(timer, struct emul_motion_data, timer);
+	int16_t dx;
+	int16_t dy;
+
+	if ((data->samples++ % TARGET_PERIOD) == 0) {
+		data->target_x = target_get(data->speed);
+		data->target_y = target_get(data->speed);
+	}
+
+	data->vel_x += (data->target_x - data->vel_x) >> VELOCITY_FILTER_SHIFT;
+	data->vel_y += (data->target_y - data->vel_y) >> VELOCITY_FILTER_SHIFT;
+
+	dx = motion_get(data->vel_x, data->rate_hz, &data->rem_x);
+	dy = motion_get(data->vel_y, data->rate_hz, &data->rem_y);
+
+	/* The motion flag of the sensor is not set, nothing to read. */
+	if (!dx && !dy) {
+		return;
+	}
+
+	input_report_rel(data->dev, INPUT_REL_X, dx, false, K_NO_WAIT);
+	input_report_rel(data->dev, INPUT_REL_Y, dy, true, K_NO_WAIT);
+}
+
+int emul_motion_sensor_set(const struct device *dev, uint32_t rate_hz, uint32_t speed)
+{
+	struct emul_motion_data *data = dev->data;
+
+	if (rate_hz > SAMPLE_RATE_MAX_HZ) {
+		return -EINVAL;
+	}
+
+	k_timer_stop(&data->timer);
+
+	if (!rate_hz) {
+		return 0;
+	}
+
+	data->rate_hz = rate_hz;
+	data->speed = MIN(speed, INT16_MAX);
+	data->samples = 0;
+	data->vel_x = 0;
+	data->vel_y = 0;
+	data->rem_x = 0;
+	data->rem_y = 0;
+
+	k_timer_start(&data->timer, K_NO_WAIT, K_USEC(USEC_PER_SEC / rate_hz));
+
+	return 0;
+}
+
+static int emul_motion_init(const struct device *dev)
+{
+	const struct emul_motion_config *config = dev->config;
+	struct emul_motion_data *data = dev->data;
+
+	data->dev = dev;
+	k_timer_init(&data->timer, emul_motion_timer_handler, NULL);
+
+	if (config->autostart) {
+		return emul_motion_sensor_set(dev, config->rate_hz, config->speed);
+	}
+
+	return 0;
+}
+
+#define EMUL_MOTION_DEFINE(inst)						\
+	BUILD_ASSERT(DT_INST_PROP(inst, sample_rate_hz) <= SAMPLE_RATE_MAX_HZ);	\
+										\
+	static const struct emul_motion_config emul_motion_config_##inst = {	\
+		.rate_hz = DT_INST_PROP(inst, sample_rate_hz),			\
+		.speed = DT_INST_PROP(inst, speed),				\
+		.autostart = DT_INST_PROP(inst, autostart),			\
+	};									\
+										\
+	static struct emul_motion_data emul_motion_data_##inst;			\
+										\
+	DEVICE_DT_INST_DEFINE(inst, emul_motion_init, NULL,			\
+			      &emul_motion_data_##inst, &emul_motion_config_##inst, \
+			      POST_KERNEL, CONFIG_APPLICATION_INIT_PRIORITY, NULL);
+
+DT_INST_FOREACH_STATUS_OKAY(EMUL_MOTION_DEFINE)
+
+#if defined(CONFIG_SHELL)
+static int cmd_hid_sensor(const struct shell *sh, size_t argc, char **argv)
+{
+	const struct device *dev = DEVICE_DT_GET(DT_DRV_INST(0));
+	const struct emul_motion_config *config = dev->config;
+	unsigned long rate_hz = 0;
+	unsigned long speed = config->speed;
+	int err = 0;
+
+	if (strcmp(argv[1], "stop")) {
+		rate_hz = shell_strtoul(argv[1], 0, &err);
+		if (argc > 2) {
+			speed = shell_strtoul(argv[2], 0, &err);
+		}
+
+		if (err || !rate_hz) {
+			shell_error(sh, "Invalid sensor parameters");
+			return -EINVAL;
+		}
+	}
+
+	err = emul_motion_sensor_set(dev, rate_hz, speed);
+	if (err) {
+		shell_error(sh, "Sample rate above %u Hz", SAMPLE_RATE_MAX_HZ);
+	}
+
+	return err;
+}
+
+SHELL_SUBCMD_ADD((hid), sensor, NULL,
+		 "Run the emulated motion sensor <rate_hz|stop> [speed]",
+		 cmd_hid_sensor, 2, 1);
+#endif /* defined(CONFIG_SHELL) */
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef EMUL_MOTION_SENSOR_H_
+#define EMUL_MOTION_SENSOR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr/device.h>
+
+/** @brief Start, restart or stop the emulated motion sensor.
+ *
+ *  @param dev Emulated motion sensor device.
+ *  @param rate_hz Sample rate in Hz, 0 stops the sensor.
+ *  @param speed Peak motion speed in counts per second.
+ *
+ *  @retval 0 if the operation was successful, otherwise a (negative) error code.
+ */
+int emul_motion_sensor_set(const struct device *dev, uint32_t rate_hz, uint32_t speed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EMUL_MOTION_SENSOR_H_ */
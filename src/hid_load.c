@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/random/random.h>
+#include <zephyr/shell/shell.h>
+#include <string.h>
+
+#include "mouse.h"
+#include "stats.h"
+
+/* Number of samples per revolution of the circle pattern. */
+#define CIRCLE_STEPS            64
+/* Number of samples per segment of the zigzag pattern. */
+#define ZIGZAG_SEGMENT          16
+/* Time given to the pipeline to drain the queue before reporting. */
+#define REPORT_DELAY_MS         200
+
+#define LOAD_RATE_MAX_HZ        8000
+/* Longest run, one hour. */
+#define LOAD_DURATION_MAX_MS    3600000
+#define LOAD_AMPLITUDE_DEFAULT  5
+
+enum load_pattern {
+	LOAD_PATTERN_CIRCLE,
+	LOAD_PATTERN_ZIGZAG,
+	LOAD_PATTERN_WALK,
+	LOAD_PATTERN_FLICK,
+
+	LOAD_PATTERN_COUNT
+};
+
+static const char * const pattern_name[LOAD_PATTERN_COUNT] = {
+	[LOAD_PATTERN_CIRCLE] = "circle",
+	[LOAD_PATTERN_ZIGZAG] = "zigzag",
+	[LOAD_PATTERN_WALK]   = "walk",
+	[LOAD_PATTERN_FLICK]  = "flick",
+};
+
+/* One period of a sine wave in Q14. */
+static const int16_t sine_q14[CIRCLE_STEPS] = {
+	     0,   1606,   3196,   4756,   6270,   7723,   9102,  10394,
+	 11585,  12665,  13623,  14449,  15137,  15679,  16069,  16305,
+	 16384,  16305,  16069,  15679,  15137,  14449,  13623,  12665,
+	 11585,  10394,   9102,   7723,   6270,   4756,   3196,   1606,
+	     0,  -1606,  -3196,  -4756,  -6270,  -7723,  -9102, -10394,
+	-11585, -12665, -13623, -14449, -15137, -15679, -16069, -16305,
+	-16384, -16305, -16069, -15679, -15137, -14449, -13623, -12665,
+	-11585, -10394,  -9102,  -7723,  -6270,  -4756,  -3196,  -1606,
+};
+
+static struct load_state {
+	const struct shell *sh;
+	enum load_pattern pattern;
+	int16_t amplitude;
+	uint32_t remaining;
+	uint32_t index;
+	int16_t walk_x;
+	int16_t walk_y;
+	uint32_t submitted;
+	uint32_t rejected;
+	int64_t start_ms;
+	int64_t stop_ms;
+	bool running;
+} load;
+
+#define load_print(fmt, ...)						\
+	do {								\
+		if (load.sh) {						\
+			shell_print(load.sh, fmt, ##__VA_ARGS__);	\
+		} else {						\
+			printk(fmt "\n", ##__VA_ARGS__);		\
+		}							\
+	} while (0)
+
+static void load_timer_handler(struct k_timer *timer);
+static K_TIMER_DEFINE(load_timer, load_timer_handler, NULL);
+
+static void load_report(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(load_report_work, load_report);
+
+static int16_t circle_point(uint32_t index, int16_t amplitude, bool cosine)
+{
+	uint32_t i = (index + (cosine ? CIRCLE_STEPS / 4 : 0)) % CIRCLE_STEPS;
+
+	return (sine_q14[i] * amplitude) >> 14;
+}
+
+static int16_t walk_step(int16_t value, int16_t amplitude)
+{
+	int16_t step = (int16_t)(sys_rand32_get() % 5) - 2;
+
+	return CLAMP(value + step, -amplitude, amplitude);
+}
+
+static void load_sample_get(int16_t *x_delta, int16_t *y_delta)
+{
+	uint32_t i = load.index++;
+
+	switch (load.pattern) {
+	case LOAD_PATTERN_CIRCLE:
+		*x_delta = circle_point(i + 1, load.amplitude, true) -
+			   circle_point(i, load.amplitude, true);
+		*y_delta = circle_point(i + 1, load.amplitude, false) -
+			   circle_point(i, load.amplitude, false);
+		break;
+
+	case LOAD_PATTERN_ZIGZAG:
+		*x_delta = load.amplitude;
+		*y_delta = ((i / ZIGZAG_SEGMENT) & 1) ? -load.amplitude : load.amplitude;
+		break;
+
+	case LOAD_PATTERN_WALK:
+		load.walk_x = walk_step(load.walk_x, load.amplitude);
+		load.walk_y = walk_step(load.walk_y, load.amplitude);
+		*x_delta = load.walk_x;
+		*y_delta = load.walk_y;
+		break;
+
+	case LOAD_PATTERN_FLICK:
+	default:
+		*x_delta = (i & 1) ? -MOUSE_MOVEMENT_MAX : MOUSE_MOVEMENT_MAX;
+		*y_delta = (i & 1) ? MOUSE_MOVEMENT_MAX : -MOUSE_MOVEMENT_MAX;
+		break;
+	}
+}
+
+static void load_timer_handler(struct k_timer *timer)
+{
+	int16_t x_delta;
+	int16_t y_delta;
+
+	if (!load.remaining) {
+		k_timer_stop(&load_timer);
+		load.stop_ms = k_uptime_get();
+		k_work_schedule(&load_report_work, K_MSEC(REPORT_DELAY_MS));
+		return;
+	}
+
+	load.remaining--;
+
+	load_sample_get(&x_delta, &y_delta);
+	if (mouse_motion_submit(x_delta, y_delta)) {
+		load.rejected++;
+	} else {
+		load.submitted++;
+	}
+}
+
+static void load_report(struct k_work *work)
+{
+	uint32_t elapsed_ms = MAX(load.stop_ms - load.start_ms, 1);
+	struct stats_hid hid;
+
+	load.running = false;
+
+	stats_hid_get(&hid);
+
+	load_print("Load %s finished in %u ms", pattern_name[load.pattern], elapsed_ms);
+	load_print("samples: submitted %u, rejected %u", load.submitted, load.rejected);
+	load_print("reports: %u (%u/s), merges %u", hid.reports,
+		   (uint32_t)((hid.reports * 1000ULL) / elapsed_ms), hid.merges);
+	load_print("notifications: boot %u, id1 %u, id2 %u, id3 %u",
+		   hid.notifications[STATS_HID_BOOT_REPORT_ID], hid.notifications[1],
+		   hid.notifications[2], hid.notifications[3]);
+	load_print("hids_queue: peak %u, drops %u",
+		   stats_msgq_peak_get(STATS_MSGQ_HIDS), stats_msgq_drops_get(STATS_MSGQ_HIDS));
+	load_print("latency: p50 %u us, p90 %u us, p99 %u us, max %u us",
+		   stats_hid_latency_percentile(50), stats_hid_latency_percentile(90),
+		   stats_hid_latency_percentile(99), hid.latency_max_us);
+	load_print("age at transmit: p50 %u us, p90 %u us, p99 %u us, max %u us",
+		   stats_hid_age_percentile(50), stats_hid_age_percentile(90),
+		   stats_hid_age_percentile(99), hid.age_max_us);
+}
+
+static int load_start(const struct shell *sh, enum load_pattern pattern,
+		      uint32_t rate_hz, uint32_t duration_ms, int16_t amplitude)
+{
+	if (load.running) {
+		return -EBUSY;
+	}
+
+	memset(&load, 0, sizeof(load));
+	load.sh = sh;
+	load.pattern = pattern;
+	load.amplitude = amplitude;
+	load.remaining = ((uint64_t)rate_hz * duration_ms) / MSEC_PER_SEC;
+	load.running = true;
+
+	stats_reset();
+
+	load_print("Load %s: %u Hz for %u ms (%u samples)", pattern_name[pattern],
+		   rate_hz, duration_ms, load.remaining);
+
+	load.start_ms = k_uptime_get();
+	k_timer_start(&load_timer, K_NO_WAIT, K_USEC(USEC_PER_SEC / rate_hz));
+
+	return 0;
+}
+
+static int pattern_parse(const char *name, enum load_pattern *pattern)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(pattern_name); i++) {
+		if (!strcmp(name, pattern_name[i])) {
+			*pattern = i;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static int cmd_hid_load(const struct shell *sh, size_t argc, char **argv)
+{
+	enum load_pattern pattern;
+	unsigned long rate_hz;
+	unsigned long duration_ms;
+	unsigned long amplitude = LOAD_AMPLITUDE_DEFAULT;
+	int err = 0;
+
+	if (!strcmp(argv[1], "stop")) {
+		if (load.running) {
+			load.remaining = 0;
+		}
+		return 0;
+	}
+
+	if (argc < 4) {
+		shell_error(sh, "Usage: hid load <pattern> <rate_hz> <duration_ms> [amplitude]");
+		return -EINVAL;
+	}
+
+	err = pattern_parse(argv[1], &pattern);
+	if (err) {
+		shell_error(sh, "Unknown pattern %s", argv[1]);
+		return err;
+	}
+
+	rate_hz = shell_strtoul(argv[2], 0, &err);
+	duration_ms = shell_strtoul(argv[3], 0, &err);
+	if (argc > 4) {
+		amplitude = shell_strtoul(argv[4], 0, &err);
+	}
+
+	if (err || !rate_hz || (rate_hz > LOAD_RATE_MAX_HZ) || !duration_ms ||
+	    (duration_ms > LOAD_DURATION_MAX_MS) || !amplitude ||
+	    (amplitude > MOUSE_MOVEMENT_MAX)) {
+		shell_error(sh, "Invalid load parameters");
+		return -EINVAL;
+	}
+
+	err = load_start(sh, pattern, rate_hz, duration_ms, amplitude);
+	if (err) {
+		shell_error(sh, "Load is already running");
+	}
+
+	return err;
+}
+
+SHELL_SUBCMD_ADD((hid), load, NULL,
+		 "Generate motion load <circle|zigzag|walk|flick|stop> "
+		 "<rate_hz> <duration_ms> [amplitude]",
+		 cmd_hid_load, 2, 3);
+
+#if defined(CONFIG_APP_HID_LOAD_AUTORUN)
+static void load_autorun(struct k_work *work)
+{
+	int err;
+
+	err = load_start(NULL, LOAD_PATTERN_CIRCLE, CONFIG_APP_HID_LOAD_AUTORUN_RATE_HZ,
+			 CONFIG_APP_HID_LOAD_AUTORUN_DURATION_MS, LOAD_AMPLITUDE_DEFAULT);
+	if (err) {
+		printk("Load autorun failed (err %d)\n", err);
+	}
+}
+
+static K_WORK_DELAYABLE_DEFINE(load_autorun_work, load_autorun);
+
+static int load_autorun_init(void)
+{
+	k_work_schedule(&load_autorun_work, K_MSEC(CONFIG_APP_HID_LOAD_AUTORUN_DELAY_MS));
+
+	return 0;
+}
+
+SYS_INIT(load_autorun_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+#endif /* defined(CONFIG_APP_HID_LOAD_AUTORUN) */
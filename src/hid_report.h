@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef HID_REPORT_H_
+#define HID_REPORT_H_
+
+/* Compile-time HID report descriptor and encoder generator.
+ *
+ * A report is described once as a field list macro taking an emitter
+ * prefix. Every entry of the list is one of:
+ *
+ *   E##_FIELD(name, flags, size, page, usage, logical_min, logical_max)
+ *   E##_RANGE(name, flags, size, page, usage_min, usage_max, logical_min, logical_max)
+ *   E##_PAD(name, size)
+ *
+ * Expanding the list with HID_RD_INPUT or HID_RD_FEATURE emits the report
+ * descriptor items, expanding it with HID_REPORT_LAYOUT() emits the bit
+ * offset of every field and the report length. The same list therefore
+ * drives both the report map and the encoder, which can't drift apart.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr/kernel.h>
+
+/* Short items, HID 1.11 chapter 6.2.2. */
+#define HID_RD_ITEM8(tag, val)   (tag), (uint8_t)(val)
+#define HID_RD_ITEM16(tag, val)  (tag), (uint8_t)((uint16_t)(val) & 0xFF), \
+				 (uint8_t)((uint16_t)(val) >> 8)
+
+#define HID_RD_INPUT(flags)            HID_RD_ITEM8(0x81, flags)
+#define HID_RD_FEATURE(flags)          HID_RD_ITEM8(0xB1, flags)
+#define HID_RD_COLLECTION(type)        HID_RD_ITEM8(0xA1, type)
+#define HID_RD_END_COLLECTION          0xC0
+#define HID_RD_USAGE_PAGE(page)        HID_RD_ITEM8(0x05, page)
+#define HID_RD_LOGICAL_MIN(val)        HID_RD_ITEM16(0x16, val)
+#define HID_RD_LOGICAL_MAX(val)        HID_RD_ITEM16(0x26, val)
+#define HID_RD_PHYSICAL_MIN(val)       HID_RD_ITEM8(0x35, val)
+#define HID_RD_PHYSICAL_MAX(val)       HID_RD_ITEM8(0x45, val)
+#define HID_RD_REPORT_SIZE(size)       HID_RD_ITEM8(0x75, size)
+#define HID_RD_REPORT_ID(id)           HID_RD_ITEM8(0x85, id)
+#define HID_RD_REPORT_COUNT(count)     HID_RD_ITEM8(0x95, count)
+#define HID_RD_USAGE(usage)            HID_RD_ITEM16(0x0A, usage)
+#define HID_RD_USAGE_MIN(usage)        HID_RD_ITEM16(0x1A, usage)
+#define HID_RD_USAGE_MAX(usage)        HID_RD_ITEM16(0x2A, usage)
+
+/* Main item data flags. */
+#define HID_RD_CONST                   0x01
+#define HID_RD_DATA_VAR_ABS            0x02
+#define HID_RD_DATA_VAR_REL            0x06
+
+/* Collection types. */
+#define HID_RD_PHYSICAL                0x00
+#define HID_RD_APPLICATION             0x01
+#define HID_RD_LOGICAL                 0x02
+
+/* Usage pages and usages, HID Usage Tables 1.3. */
+#define HID_PAGE_GENERIC_DESKTOP       0x01
+#define HID_PAGE_BUTTON                0x09
+#define HID_PAGE_CONSUMER              0x0C
+
+#define HID_USAGE_GD_POINTER           0x01
+#define HID_USAGE_GD_MOUSE             0x02
+#define HID_USAGE_GD_X                 0x30
+#define HID_USAGE_GD_Y                 0x31
+#define HID_USAGE_GD_WHEEL             0x38
+#define HID_USAGE_GD_RES_MULTIPLIER    0x48
+
+#define HID_USAGE_CONSUMER_CONTROL     0x01
+#define HID_USAGE_CONSUMER_NEXT_TRACK  0xB5
+#define HID_USAGE_CONSUMER_PREV_TRACK  0xB6
+#define HID_USAGE_CONSUMER_PLAY_PAUSE  0xCD
+#define HID_USAGE_CONSUMER_VOL_UP      0xE9
+#define HID_USAGE_CONSUMER_VOL_DOWN    0xEA
+#define HID_USAGE_CONSUMER_CONFIG      0x183
+#define HID_USAGE_CONSUMER_AC_BACK     0x224
+#define HID_USAGE_CONSUMER_AC_FORWARD  0x225
+#define HID_USAGE_CONSUMER_AC_PAN      0x238
+
+/* Descriptor emitters. Every field carries its own global items, so the
+ * fields do not depend on the items emitted before them. The Usage Page
+ * comes first so that the 16-bit usages that follow are interpreted on it.
+ */
+#define HID_RD_FIELD_ITEMS(main, flags, size, count, lmin, lmax)	\
+	HID_RD_LOGICAL_MIN(lmin),					\
+	HID_RD_LOGICAL_MAX(lmax),					\
+	HID_RD_REPORT_SIZE(size),					\
+	HID_RD_REPORT_COUNT(count),					\
+	main(flags),
+
+#define HID_RD_INPUT_FIELD(name, flags, size, page, usage, lmin, lmax)	\
+	HID_RD_USAGE_PAGE(page),					\
+	HID_RD_USAGE(usage),						\
+	HID_RD_FIELD_ITEMS(HID_RD_INPUT, flags, size, 1, lmin, lmax)
+
+#define HID_RD_INPUT_RANGE(name, flags, size, page, umin, umax, lmin, lmax) \
+	HID_RD_USAGE_PAGE(page),					\
+	HID_RD_USAGE_MIN(umin),						\
+	HID_RD_USAGE_MAX(umax),						\
+	HID_RD_FIELD_ITEMS(HID_RD_INPUT, flags, size, (umax) - (umin) + 1,	\
+			   lmin, lmax)
+
+#define HID_RD_INPUT_PAD(name, size)					\
+	HID_RD_REPORT_SIZE(size),					\
+	HID_RD_REPORT_COUNT(1),						\
+	HID_RD_INPUT(HID_RD_CONST),
+
+#define HID_RD_FEATURE_FIELD(name, flags, size, page, usage, lmin, lmax) \
+	HID_RD_USAGE_PAGE(page),					\
+	HID_RD_USAGE(usage),						\
+	HID_RD_FIELD_ITEMS(HID_RD_FEATURE, flags, size, 1, lmin, lmax)
+
+#define HID_RD_FEATURE_RANGE(name, flags, size, page, umin, umax, lmin, lmax) \
+	HID_RD_USAGE_PAGE(page),					\
+	HID_RD_USAGE_MIN(umin),						\
+	HID_RD_USAGE_MAX(umax),						\
+	HID_RD_FIELD_ITEMS(HID_RD_FEATURE, flags, size, (umax) - (umin) + 1, \
+			   lmin, lmax)
+
+#define HID_RD_FEATURE_PAD(name, size)					\
+	HID_RD_REPORT_SIZE(size),					\
+	HID_RD_REPORT_COUNT(1),						\
+	HID_RD_FEATURE(HID_RD_CONST),
+
+/* Layout emitters: name##_OFFSET is the first bit of a field and
+ * name##_END its last one, so the next enumerator starts right after it.
+ */
+#define HID_LAYOUT_FIELD(name, flags, size, page, usage, lmin, lmax)	\
+	name##_OFFSET,							\
+	name##_END = name##_OFFSET + (size) - 1,
+
+#define HID_LAYOUT_RANGE(name, flags, size, page, umin, umax, lmin, lmax) \
+	name##_OFFSET,							\
+	name##_END = name##_OFFSET + (size) * ((umax) - (umin) + 1) - 1,
+
+#define HID_LAYOUT_PAD(name, size)					\
+	name##_OFFSET,							\
+	name##_END = name##_OFFSET + (size) - 1,
+
+/** @brief Define the layout of a report.
+ *
+ *  Defines the bit offsets of all fields of the report and
+ *  name##_BITS, the total report size in bits.
+ *
+ *  @param name Report name.
+ *  @param fields Field list macro of the report.
+ */
+#define HID_REPORT_LAYOUT(name, fields)					\
+	enum {								\
+		fields(HID_LAYOUT)					\
+		name##_BITS						\
+	};								\
+	BUILD_ASSERT((name##_BITS % 8) == 0, #name " is not byte aligned")
+
+/** @brief Length of a report in bytes. */
+#define HID_REPORT_LEN(name) (name##_BITS / 8)
+
+/** @brief Size of a report field in bits. */
+#define HID_REPORT_FIELD_BITS(field) (field##_END - field##_OFFSET + 1)
+
+/** @brief Encode a field of a report.
+ *
+ *  @param buf Report buffer.
+ *  @param field Field name.
+ *  @param value Field value, truncated to the field size.
+ */
+#define HID_REPORT_FIELD_PUT(buf, field, value)				\
+	hid_report_bits_put((buf), field##_OFFSET, HID_REPORT_FIELD_BITS(field), (value))
+
+/** @brief Decode an unsigned field of a report.
+ *
+ *  @param buf Report buffer.
+ *  @param field Field name.
+ */
+#define HID_REPORT_FIELD_GET(buf, field)				\
+	hid_report_bits_get((buf), field##_OFFSET, HID_REPORT_FIELD_BITS(field))
+
+/* The offsets and sizes are compile-time constants at every call site, so
+ * the loops below are unrolled into a few shifts and masks per field.
+ */
+static ALWAYS_INLINE void hid_report_bits_put(uint8_t *buf, uint32_t offset, uint32_t bits,
+					      int32_t value)
+{
+	uint32_t val = (uint32_t)value;
+
+	while (bits) {
+		uint32_t shift = offset % 8;
+		uint32_t len = MIN(8 - shift, bits);
+		uint8_t mask = BIT_MASK(len) << shift;
+
+		buf[offset / 8] = (buf[offset / 8] & ~mask) | ((val << shift) & mask);
+
+		val >>= len;
+		offset += len;
+		bits -= len;
+	}
+}
+
+static ALWAYS_INLINE uint32_t hid_report_bits_get(const uint8_t *buf, uint32_t offset,
+						  uint32_t bits)
+{
+	uint32_t val = 0;
+	uint32_t pos = 0;
+
+	while (pos < bits) {
+		uint32_t shift = offset % 8;
+		uint32_t len = MIN(8 - shift, bits - pos);
+
+		val |= ((buf[offset / 8] >> shift) & BIT_MASK(len)) << pos;
+
+		offset += len;
+		pos += len;
+	}
+
+	return val;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HID_REPORT_H_ */
@@ -24,57 +24,119 @@
 #include <zephyr/bluetooth/uuid.h>
 #include <zephyr/bluetooth/gatt.h>
 
-#include <zephyr/bluetooth/services/bas.h>
 #include <bluetooth/services/hids.h>
 #include <zephyr/bluetooth/services/dis.h>
 #include <dk_buttons_and_leds.h>
 
 
-#include <dm.h>
 #include <zephyr/shell/shell.h>
 
+#include "accel.h"
+#include "advertising.h"
+#include "airtime.h"
+#include "angle.h"
+#include "battery.h"
+#include "bond_cache.h"
+#include "conn_sync.h"
+#include "hid_report.h"
+#include "mouse.h"
+#include "mouse_report.h"
 #include "peer.h"
 #include "pwm_led.h"
+#include "ranging.h"
 #include "service.h"
-
-
-
-#define DEVICE_NAME     CONFIG_BT_DEVICE_NAME
-#define DEVICE_NAME_LEN (sizeof(DEVICE_NAME) - 1)
+#include "stats.h"
 
 #define BASE_USB_HID_SPEC_VERSION   0x0101
 
 /* Number of pixels by which the cursor is moved when a button is pushed. */
 #define MOVEMENT_SPEED              5
+
+/* Length of Mouse Input Report containing media player data. */
+#define INPUT_REP_MEDIA_PLAYER_LEN  HID_REPORT_LEN(INPUT_REP_MEDIA_PLAYER)
+#if defined(CONFIG_APP_HID_COMBINED_REPORT)
+/* Number of input reports in this application. */
+#define INPUT_REPORT_COUNT          2
+/* Length of Mouse Input Report containing button, movement and scroll data. */
+#define INPUT_REP_BUTTONS_LEN       HID_REPORT_LEN(INPUT_REP_BUTTONS)
+/* Index of Mouse Input Report containing button, movement and scroll data. */
+#define INPUT_REP_BUTTONS_INDEX     0
+/* Index of Mouse Input Report containing media player data. */
+#define INPUT_REP_MPLAYER_INDEX     1
+/* Index of the input report carrying the motion. */
+#define INPUT_REP_MOTION_INDEX      INPUT_REP_BUTTONS_INDEX
+#else
 /* Number of input reports in this application. */
 #define INPUT_REPORT_COUNT          3
 /* Length of Mouse Input Report containing button data. */
-#define INPUT_REP_BUTTONS_LEN       3
+#define INPUT_REP_BUTTONS_LEN       HID_REPORT_LEN(INPUT_REP_BUTTONS)
 /* Length of Mouse Input Report containing movement data. */
-#define INPUT_REP_MOVEMENT_LEN      3
-/* Length of Mouse Input Report containing media player data. */
-#define INPUT_REP_MEDIA_PLAYER_LEN  1
+#define INPUT_REP_MOVEMENT_LEN      HID_REPORT_LEN(INPUT_REP_MOVEMENT)
 /* Index of Mouse Input Report containing button data. */
 #define INPUT_REP_BUTTONS_INDEX     0
 /* Index of Mouse Input Report containing movement data. */
 #define INPUT_REP_MOVEMENT_INDEX    1
 /* Index of Mouse Input Report containing media player data. */
 #define INPUT_REP_MPLAYER_INDEX     2
+/* Index of the input report carrying the motion. */
+#define INPUT_REP_MOTION_INDEX      INPUT_REP_MOVEMENT_INDEX
+#endif
 /* Id of reference to Mouse Input Report containing button data. */
 #define INPUT_REP_REF_BUTTONS_ID    1
 /* Id of reference to Mouse Input Report containing movement data. */
 #define INPUT_REP_REF_MOVEMENT_ID   2
 /* Id of reference to Mouse Input Report containing media player data. */
 #define INPUT_REP_REF_MPLAYER_ID    3
-
-
-int addr12[6];
+/* Length of Feature Report containing the scroll resolution multipliers. */
+#define FEATURE_REP_RES_MULT_LEN    HID_REPORT_LEN(FEATURE_REP_RES_MULT)
+/* Index of Feature Report containing the scroll resolution multipliers. */
+#define FEATURE_REP_RES_MULT_INDEX  0
+/* Id of reference to Feature Report containing the scroll resolution multipliers. */
+#define FEATURE_REP_REF_RES_MULT_ID 4
 
 
 
 /* HIDs queue size. */
 #define HIDS_QUEUE_SIZE 10
 
+/* Time given to the hosts to disconnect before Bluetooth is suspended. */
+#define SUSPEND_DISCONNECT_POLL_MS  10
+#define SUSPEND_DISCONNECT_POLLS    50
+
+#if defined(CONFIG_APP_HID_SUSPEND)
+/* Connection parameters while the host is suspended. */
+#define HOST_SUSPEND_INT_MIN        80  /* 100 ms in 1.25 ms units */
+#define HOST_SUSPEND_INT_MAX        100 /* 125 ms in 1.25 ms units */
+#define HOST_SUSPEND_LATENCY        4
+#define HOST_SUSPEND_TIMEOUT        600 /* 6 s in 10 ms units */
+/* Connection parameters for low latency reporting. */
+#define HOST_ACTIVE_INT_MIN         6   /* 7.5 ms in 1.25 ms units */
+#define HOST_ACTIVE_INT_MAX         12  /* 15 ms in 1.25 ms units */
+#define HOST_ACTIVE_LATENCY         0
+#define HOST_ACTIVE_TIMEOUT         400 /* 4 s in 10 ms units */
+/* A wake up taking longer is not reported, the update got lost. */
+#define HOST_WAKE_TIMEOUT_MS        5000
+/* A host that received input this recently is not relaxed by a suspend
+ * request, the request most likely comes from another host.
+ */
+#define HOST_SUSPEND_HOLDOFF_MS     2000
+
+/* Host suspend requests of the HID Control Point. */
+#define HOST_REQ_NONE               0
+#define HOST_REQ_SUSPEND            1
+#define HOST_REQ_EXIT_SUSPEND       2
+#endif
+
+/* Number of tracked in-flight notifications per connection, power of two. */
+#define TX_AGE_RING_SIZE 16
+
+/* Number of ATT TX buffers kept free for motion reports. */
+#define MEDIA_TX_RESERVE  2
+/* Retry delay of a deferred report when no TX buffer release is pending. */
+#define TX_RETRY_DELAY_MS 10
+/* Maximum number of pending clicks of a single media key. */
+#define MEDIA_PENDING_MAX 3
+
 /* Key used to move cursor left */
 #define KEY_LEFT_MASK   DK_BTN1_MSK
 /* Key used to move cursor up */
@@ -83,58 +145,128 @@ int addr12[6];
 #define KEY_RIGHT_MASK  DK_BTN3_MSK
 /* Key used to move cursor down */
 #define KEY_DOWN_MASK   DK_BTN4_MSK
+/* Keys pressed together to move the focus to the next host */
+#define KEY_HOST_CHORD_MASK (KEY_LEFT_MASK | KEY_RIGHT_MASK)
 
 /* Key used to accept or reject passkey value */
 #define KEY_PAIRING_ACCEPT DK_BTN1_MSK
 #define KEY_PAIRING_REJECT DK_BTN2_MSK
 
 /* HIDS instance. */
+#if defined(CONFIG_APP_HID_COMBINED_REPORT)
+BT_HIDS_DEF(hids_obj,
+	    INPUT_REP_BUTTONS_LEN,
+	    INPUT_REP_MEDIA_PLAYER_LEN,
+	    FEATURE_REP_RES_MULT_LEN);
+#else
 BT_HIDS_DEF(hids_obj,
 	    INPUT_REP_BUTTONS_LEN,
 	    INPUT_REP_MOVEMENT_LEN,
-	    INPUT_REP_MEDIA_PLAYER_LEN);
+	    INPUT_REP_MEDIA_PLAYER_LEN,
+	    FEATURE_REP_RES_MULT_LEN);
+#endif
 
 static struct k_work hids_work;
 struct mouse_pos {
 	int16_t x_val;
 	int16_t y_val;
+	uint32_t timestamp;
 };
 
+/* Mouse buttons state, reported in the buttons input report. */
+static struct {
+	struct k_spinlock lock;
+	uint8_t state;
+	uint8_t sent;
+} btn_rep;
+
+/* Media player keys state, reported in the media player input report. */
+static struct {
+	struct k_spinlock lock;
+	uint8_t pending[MOUSE_MEDIA_KEY_COUNT];
+	/* Keys of the click being delivered, 0 if none. */
+	uint8_t pressed;
+	/* The press reached all hosts, the release is being delivered. */
+	bool released;
+} media_rep;
+
+/* An input report was deferred until a TX buffer is released. */
+static atomic_t tx_deferred;
+
 /* Mouse movement queue. */
 K_MSGQ_DEFINE(hids_queue,
 	      sizeof(struct mouse_pos),
 	      HIDS_QUEUE_SIZE,
 	      4);
 
-#if CONFIG_BT_DIRECTED_ADVERTISING
-/* Bonded address queue. */
-K_MSGQ_DEFINE(bonds_queue,
-	      sizeof(bt_addr_le_t),
-	      CONFIG_BT_MAX_PAIRED,
-	      4);
-#endif
-
-static const struct bt_data ad[] = {
-	BT_DATA_BYTES(BT_DATA_GAP_APPEARANCE,
-		      (CONFIG_BT_DEVICE_APPEARANCE >> 0) & 0xff,
-		      (CONFIG_BT_DEVICE_APPEARANCE >> 8) & 0xff),
-	BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
-	BT_DATA_BYTES(BT_DATA_UUID16_ALL, BT_UUID_16_ENCODE(BT_UUID_HIDS_VAL),
-					  BT_UUID_16_ENCODE(BT_UUID_BAS_VAL)),
-};
-
-static const struct bt_data sd[] = {
-	BT_DATA(BT_DATA_NAME_COMPLETE, DEVICE_NAME, DEVICE_NAME_LEN),
-};
-
 static struct conn_mode {
 	struct bt_conn *conn;
 	bool in_boot_mode;
+	/* Accumulated scroll in 1/MOUSE_SCROLL_RES_MULTIPLIER of a detent. */
+	int16_t wheel;
+	int16_t pan;
+	/* The host enabled the resolution multiplier. */
+	bool hires_wheel;
+	bool hires_pan;
+	/* Oldest sample timestamps of the in-flight notifications, 0 for
+	 * notifications that carry no motion.
+	 */
+	uint32_t tx_sample_ts[TX_AGE_RING_SIZE];
+	uint8_t tx_head;
+	uint8_t tx_tail;
+	/* Number of input report notifications waiting for transmission. */
+	atomic_t tx_in_flight;
+	/* Number of completed notifications, and the number at which the
+	 * last buttons report is completed. The notifications of a
+	 * connection complete in the order they are sent.
+	 */
+	atomic_t tx_done;
+	atomic_val_t btn_tx_done;
+	/* Last media player report the host accepted. */
+	uint8_t media_sent;
+	/* The link is encrypted and the host enabled the notifications. */
+	bool ready;
+	/* Motion accumulated until the connection is ready. */
+	int32_t pend_x;
+	int32_t pend_y;
+	/* Connection time, cleared once the first report is delivered. */
+	uint32_t connected_ts;
+#if defined(CONFIG_APP_HID_SUSPEND)
+	/* The host is suspended and the connection is relaxed. */
+	bool suspended;
+	/* Time of the wake up by input, cleared by the next connection update. */
+	uint32_t wake_ts;
+	/* Uptime of the last input routed to the host, 0 if none. */
+	uint32_t input_ts;
+#endif
 } conn_mode[CONFIG_BT_HIDS_MAX_CLIENT_COUNT];
 
-static volatile bool is_adv_running;
+#if defined(CONFIG_APP_HID_FOCUS)
+/* Focus change requests, handled in the HID report work. */
+#define FOCUS_REQ_NONE  -1
+#define FOCUS_REQ_NEXT  -2
 
-static struct k_work adv_work;
+/* Index of the host in conn_mode[] that receives the input, -1 if none. */
+static int focus_idx = -1;
+static atomic_t focus_req = ATOMIC_INIT(FOCUS_REQ_NONE);
+#endif
+
+static struct k_spinlock tx_age_lock;
+/* Oldest sample timestamp of the motion report being sent. */
+static uint32_t tx_sample_ts;
+
+#if defined(CONFIG_APP_HID_SUSPEND)
+static atomic_t host_suspend_req;
+#endif
+
+/* Bluetooth is disabled by mouse_bt_suspend(). */
+static bool bt_suspended;
+
+/* Last disconnected host, used to measure the time to reconnect. */
+static struct {
+	bt_addr_le_t addr;
+	uint32_t timestamp;
+} last_disconnect;
 
 static struct k_work pairing_work;
 struct pairing_data_mitm {
@@ -147,119 +279,6 @@ K_MSGQ_DEFINE(mitm_queue,
 	      CONFIG_BT_HIDS_MAX_CLIENT_COUNT,
 	      4);
 
-#if CONFIG_BT_DIRECTED_ADVERTISING
-/**
- * Функция для поиска пары (bond) в списке известных устройств.
- * Если устройство уже подключено, то пропускаем его.
- * Если устройство не подключено, то добавляем его в очередь пар.
- *
- * @param info Информация о паре (bond).
- * @param user_data Дополнительные данные, переданные в функцию.
- */
-static void bond_find(const struct bt_bond_info *info, void *user_data)
-{
-    // Переменная для хранения ошибки
-    int err;
-
-    /**
-     * Фильтрация уже подключенных устройств.
-     * Если устройство уже подключено, то пропускаем его.
-     */
-    for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
-        if (conn_mode[i].conn) {
-            // Адрес устройства, с которым установлено соединение
-            const bt_addr_le_t *dst = bt_conn_get_dst(conn_mode[i].conn);
-
-            // Сравнение адресов устройств
-            if (!bt_addr_le_cmp(&info->addr, dst)) {
-                // Если адреса совпадают, то пропускаем устройство
-                return;
-            }
-        }
-    }
-
-    /**
-     * Добавление устройства в очередь пар.
-     * Если очередь заполнена, то выводим сообщение об ошибке.
-     */
-    err = k_msgq_put(&bonds_queue, (void *) &info->addr, K_NO_WAIT);
-    if (err) {
-        printk("No space in the queue for the bond.\n");
-    }
-}
-#endif
-
-static void advertising_continue(void)
-{
-	struct bt_le_adv_param adv_param;
-
-#if CONFIG_BT_DIRECTED_ADVERTISING
-	bt_addr_le_t addr;
-
-	if (!k_msgq_get(&bonds_queue, &addr, K_NO_WAIT)) {
-		char addr_buf[BT_ADDR_LE_STR_LEN];
-		int err;
-
-		if (is_adv_running) {
-			err = bt_le_adv_stop();
-			if (err) {
-				printk("Advertising failed to stop (err %d)\n", err);
-				return;
-			}
-			is_adv_running = false;
-		}
-
-		adv_param = *BT_LE_ADV_CONN_DIR(&addr);
-		adv_param.options |= BT_LE_ADV_OPT_DIR_ADDR_RPA;
-
-		err = bt_le_adv_start(&adv_param, NULL, 0, NULL, 0);
-
-		if (err) {
-			printk("Directed advertising failed to start (err %d)\n", err);
-			return;
-		}
-
-		bt_addr_le_to_str(&addr, addr_buf, BT_ADDR_LE_STR_LEN);
-		printk("Direct advertising to %s started\n", addr_buf);
-	} else
-#endif
-	{
-		int err;
-
-		if (is_adv_running) {
-			return;
-		}
-
-		adv_param = *BT_LE_ADV_CONN;
-		adv_param.options |= BT_LE_ADV_OPT_ONE_TIME;
-		err = bt_le_adv_start(&adv_param, ad, ARRAY_SIZE(ad),
-				  sd, ARRAY_SIZE(sd));
-		if (err) {
-			printk("Advertising failed to start (err %d)\n", err);
-			return;
-		}
-
-		printk("Regular advertising started\n");
-	}
-
-	is_adv_running = true;
-}
-
-static void advertising_start(void)
-{
-#if CONFIG_BT_DIRECTED_ADVERTISING
-	k_msgq_purge(&bonds_queue);
-	bt_foreach_bond(BT_ID_DEFAULT, bond_find, NULL);
-#endif
-
-	k_work_submit(&adv_work);
-}
-
-static void advertising_process(struct k_work *work)
-{
-	advertising_continue();
-}
-
 static void pairing_process(struct k_work *work)
 {
 	int err;
@@ -277,12 +296,42 @@ static void pairing_process(struct k_work *work)
 }
 
 
+static struct conn_mode *conn_mode_get(struct bt_conn *conn)
+{
+	for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
+		if (conn_mode[i].conn == conn) {
+			return &conn_mode[i];
+		}
+	}
+
+	return NULL;
+}
+
 static void insert_conn_object(struct bt_conn *conn)
 {
 	for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
 		if (!conn_mode[i].conn) {
 			conn_mode[i].conn = conn;
 			conn_mode[i].in_boot_mode = false;
+			conn_mode[i].wheel = 0;
+			conn_mode[i].pan = 0;
+			conn_mode[i].hires_wheel = false;
+			conn_mode[i].hires_pan = false;
+			conn_mode[i].tx_head = 0;
+			conn_mode[i].tx_tail = 0;
+			atomic_clear(&conn_mode[i].tx_in_flight);
+			atomic_clear(&conn_mode[i].tx_done);
+			conn_mode[i].btn_tx_done = 0;
+			conn_mode[i].media_sent = 0;
+			conn_mode[i].ready = false;
+			conn_mode[i].pend_x = 0;
+			conn_mode[i].pend_y = 0;
+			conn_mode[i].connected_ts = MAX(k_cycle_get_32(), 1);
+#if defined(CONFIG_APP_HID_SUSPEND)
+			conn_mode[i].suspended = false;
+			conn_mode[i].wake_ts = 0;
+			conn_mode[i].input_ts = 0;
+#endif
 
 			return;
 		}
@@ -303,75 +352,40 @@ static bool is_conn_slot_free(void)
 	return false;
 }
 
-int change(int x){
-    switch (x)
-    {
-    case 48:
-        return 0x0;
-        break;
-    case 49:
-        return 0x1;
-        break;
-    case 50:
-        return 0x2;
-        break;
-    case 51:
-        return 0x3;
-        break;
-    case 52:
-        return 0x4;
-        break;
-    case 53:
-        return 0x5;
-        break;
-    case 54:
-        return 0x6;
-        break;
-    case 55:
-        return 0x7;
-        break;
-    case 56:
-        return 0x8;
-        break;
-    case 57:
-        return 0x9;
-        break;
-    case 65:
-        return 0xA;
-        break;
-    case 66:
-        return 0xB;
-        break;
-    case 67:
-        return 0xC;
-        break;
-    case 68:
-        return 0xD;
-        break;
-    case 69:
-        return 0xE;
-        break;
-    case 70:
-        return 0xF;
-        break;
-    default:
-        return 0xF;
-        break;
-    }
+static bool is_any_conn_active(void)
+{
+	for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
+		if (conn_mode[i].conn) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Check if the input reports are sent to a connection. */
+static bool conn_is_routed(size_t idx)
+{
+	if (!conn_mode[idx].conn) {
+		return false;
+	}
+
+#if defined(CONFIG_APP_HID_FOCUS)
+	return idx == focus_idx;
+#else
+	return true;
+#endif
 }
 
 static void connected(struct bt_conn *conn, uint8_t err)
 {
 	char addr[BT_ADDR_LE_STR_LEN];
 
-	is_adv_running = false;
-
 	bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
 
 	if (err) {
 		if (err == BT_HCI_ERR_ADV_TIMEOUT) {
 			printk("Direct advertising to %s timed out\n", addr);
-			k_work_submit(&adv_work);
 		} else {
 			printk("Failed to connect to %s (%u)\n", addr, err);
 		}
@@ -379,12 +393,17 @@ static void connected(struct bt_conn *conn, uint8_t err)
 	}
 
 	printk("Connected %s\n", addr);
+	stats_boot_mark(STATS_BOOT_FIRST_CONN);
+
+	if (last_disconnect.timestamp &&
+	    !bt_addr_le_cmp(bt_conn_get_dst(conn), &last_disconnect.addr)) {
+		uint32_t time_us = k_cyc_to_us_floor32(k_cycle_get_32() -
+						       last_disconnect.timestamp);
 
-    int j = 0;
-    for(int i = 0; i < 6; i++) {
-        addr12[i] = ((change(addr[j])<<4)) | (change(addr[j + 1]));
-        j+=3;
-    }
+		printk("Reconnected after %u ms\n", time_us / USEC_PER_MSEC);
+		stats_bt_reconnect(time_us);
+		last_disconnect.timestamp = 0;
+	}
 
 	err = bt_hids_connected(&hids_obj, conn);
 
@@ -395,8 +414,20 @@ static void connected(struct bt_conn *conn, uint8_t err)
 
 	insert_conn_object(conn);
 
+#if defined(CONFIG_APP_HID_FOCUS)
+	/* A host without focus gets it in the HID report work. */
+	k_work_submit(&hids_work);
+#endif
+
+	/* The advertising sets are gone while Bluetooth is suspended. */
+	if (bt_suspended) {
+		return;
+	}
+
 	if (is_conn_slot_free()) {
 		advertising_start();
+	} else {
+		advertising_stop();
 	}
 }
 
@@ -410,6 +441,9 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
 
 	printk("Disconnected from %s (reason %u)\n", addr, reason);
 
+	bt_addr_le_copy(&last_disconnect.addr, bt_conn_get_dst(conn));
+	last_disconnect.timestamp = k_cycle_get_32();
+
 	err = bt_hids_disconnected(&hids_obj, conn);
 
 	if (err) {
@@ -418,12 +452,24 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
 
 	for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
 		if (conn_mode[i].conn == conn) {
+			/* Notifications pending on the link are not completed. */
+			atomic_clear(&conn_mode[i].tx_in_flight);
 			conn_mode[i].conn = NULL;
 			break;
 		}
 	}
 
-	advertising_start();
+#if defined(CONFIG_APP_HID_FOCUS)
+	/* Hand the focus over to the remaining host without delay. */
+	k_work_submit(&hids_work);
+#endif
+
+	/* Direct the advertising to the host that just left first. */
+	bond_cache_touch(bt_conn_get_dst(conn));
+
+	if (!bt_suspended) {
+		advertising_start();
+	}
 }
 
 
@@ -437,6 +483,8 @@ static void security_changed(struct bt_conn *conn, bt_security_t level,
 
 	if (!err) {
 		printk("Security changed: %s level %u\n", addr, level);
+		/* Flush the input kept until the link got encrypted. */
+		k_work_submit(&hids_work);
 	} else {
 		printk("Security failed: %s level %u err %d\n", addr, level,
 			err);
@@ -445,12 +493,43 @@ static void security_changed(struct bt_conn *conn, bt_security_t level,
 #endif
 
 
+#if defined(CONFIG_APP_HID_SUSPEND)
+static void le_param_updated(struct bt_conn *conn, uint16_t interval,
+			     uint16_t latency, uint16_t timeout)
+{
+	struct conn_mode *mode = conn_mode_get(conn);
+	uint32_t time_us;
+
+	if (!mode || !mode->wake_ts) {
+		return;
+	}
+
+	/* This is the outcome of the update requested on wake up, whether
+	 * or not the host accepted the low latency parameters.
+	 */
+	time_us = k_cyc_to_us_floor32(k_cycle_get_32() - mode->wake_ts);
+	mode->wake_ts = 0;
+
+	if ((interval > HOST_ACTIVE_INT_MAX) ||
+	    (time_us > (HOST_WAKE_TIMEOUT_MS * USEC_PER_MSEC))) {
+		return;
+	}
+
+	printk("Host woken up, connection interval %u us after %u ms\n",
+	       interval * 1250U, time_us / USEC_PER_MSEC);
+	stats_bt_wake(time_us);
+}
+#endif
+
 BT_CONN_CB_DEFINE(conn_callbacks) = {
 	.connected = connected,
 	.disconnected = disconnected,
 #ifdef CONFIG_BT_HIDS_SECURITY_ENABLED
 	.security_changed = security_changed,
 #endif
+#if defined(CONFIG_APP_HID_SUSPEND)
+	.le_param_updated = le_param_updated,
+#endif
 };
 
 
@@ -489,90 +568,124 @@ static void hids_pm_evt_handler(enum bt_hids_pm_evt evt,
 }
 
 
+#if defined(CONFIG_APP_HID_HIRES_SCROLL)
+static void res_mult_handler(struct bt_hids_rep *rep, struct bt_conn *conn, bool write)
+{
+	struct conn_mode *mode = conn_mode_get(conn);
+
+	if (!mode || (rep->size < FEATURE_REP_RES_MULT_LEN)) {
+		return;
+	}
+
+	if (write) {
+		mouse_report_res_mult_decode(rep->data, &mode->hires_wheel, &mode->hires_pan);
+
+		printk("Resolution multiplier: wheel %s, pan %s\n",
+		       mode->hires_wheel ? "on" : "off", mode->hires_pan ? "on" : "off");
+	} else {
+		memset(rep->data, 0, FEATURE_REP_RES_MULT_LEN);
+		mouse_report_res_mult_encode(rep->data, mode->hires_wheel, mode->hires_pan);
+	}
+}
+#endif
+
+#if defined(CONFIG_APP_HID_SUSPEND)
+static void hids_cp_evt_handler(enum bt_hids_cp_evt evt)
+{
+	/* The event does not tell the host, the HID report work picks the
+	 * connections it applies to and updates their parameters.
+	 */
+	if (evt == BT_HIDS_CP_EVT_HOST_SUSP) {
+		atomic_set(&host_suspend_req, HOST_REQ_SUSPEND);
+	} else if (evt == BT_HIDS_CP_EVT_HOST_EXIT_SUSP) {
+		atomic_set(&host_suspend_req, HOST_REQ_EXIT_SUSPEND);
+	}
+
+	k_work_submit(&hids_work);
+}
+#endif
+
+static void hids_motion_notify_handler(enum bt_hids_notify_evt evt)
+{
+	/* The event does not tell the connection, the work checks them all. */
+	if (evt == BT_HIDS_CCCD_EVT_NOTIFY_ENABLED) {
+		k_work_submit(&hids_work);
+	}
+}
+
 static void hid_init(void)
 {
 	int err;
 	struct bt_hids_init_param hids_init_param = { 0 };
 	struct bt_hids_inp_rep *hids_inp_rep;
+	struct bt_hids_outp_feat_rep *hids_feat_rep __maybe_unused;
+#if !defined(CONFIG_APP_HID_COMBINED_REPORT)
 	static const uint8_t mouse_movement_mask[DIV_ROUND_UP(INPUT_REP_MOVEMENT_LEN, 8)] = {0};
+#endif
 
 	static const uint8_t report_map[] = {
-		0x05, 0x01,     /* Usage Page (Generic Desktop) */
-		0x09, 0x02,     /* Usage (Mouse) */
-
-		0xA1, 0x01,     /* Collection (Application) */
-
-		/* Report ID 1: Mouse buttons + scroll/pan */
-		0x85, 0x01,       /* Report Id 1 */
-		0x09, 0x01,       /* Usage (Pointer) */
-		0xA1, 0x00,       /* Collection (Physical) */
-		0x95, 0x05,       /* Report Count (3) */
-		0x75, 0x01,       /* Report Size (1) */
-		0x05, 0x09,       /* Usage Page (Buttons) */
-		0x19, 0x01,       /* Usage Minimum (01) */
-		0x29, 0x05,       /* Usage Maximum (05) */
-		0x15, 0x00,       /* Logical Minimum (0) */
-		0x25, 0x01,       /* Logical Maximum (1) */
-		0x81, 0x02,       /* Input (Data, Variable, Absolute) */
-		0x95, 0x01,       /* Report Count (1) */
-		0x75, 0x03,       /* Report Size (3) */
-		0x81, 0x01,       /* Input (Constant) for padding */
-		0x75, 0x08,       /* Report Size (8) */
-		0x95, 0x01,       /* Report Count (1) */
-		0x05, 0x01,       /* Usage Page (Generic Desktop) */
-		0x09, 0x38,       /* Usage (Wheel) */
-		0x15, 0x81,       /* Logical Minimum (-127) */
-		0x25, 0x7F,       /* Logical Maximum (127) */
-		0x81, 0x06,       /* Input (Data, Variable, Relative) */
-		0x05, 0x0C,       /* Usage Page (Consumer) */
-		0x0A, 0x38, 0x02, /* Usage (AC Pan) */
-		0x95, 0x01,       /* Report Count (1) */
-		0x81, 0x06,       /* Input (Data,Value,Relative,Bit Field) */
-		0xC0,             /* End Collection (Physical) */
+		HID_RD_USAGE_PAGE(HID_PAGE_GENERIC_DESKTOP),
+		HID_RD_USAGE(HID_USAGE_GD_MOUSE),
+		HID_RD_COLLECTION(HID_RD_APPLICATION),
+
+		/* Report ID 1: Mouse buttons + scroll/pan, with motion in
+		 * the combined layout.
+		 */
+		HID_RD_REPORT_ID(INPUT_REP_REF_BUTTONS_ID),
+		HID_RD_USAGE(HID_USAGE_GD_POINTER),
+		HID_RD_COLLECTION(HID_RD_PHYSICAL),
+		MOUSE_REP_BUTTONS(HID_RD_INPUT)
+#if defined(CONFIG_APP_HID_COMBINED_REPORT)
+		MOUSE_REP_MOTION(HID_RD_INPUT)
+#endif
+#if defined(CONFIG_APP_HID_HIRES_SCROLL)
+		/* Each multiplier shares a logical collection with the axis
+		 * it applies to, the multipliers are in feature report ID 4.
+		 */
+		HID_RD_COLLECTION(HID_RD_LOGICAL),
+		HID_RD_REPORT_ID(FEATURE_REP_REF_RES_MULT_ID),
+		HID_RD_PHYSICAL_MIN(1),
+		HID_RD_PHYSICAL_MAX(MOUSE_SCROLL_RES_MULTIPLIER),
+		MOUSE_REP_WHEEL_RES(HID_RD_FEATURE)
+		HID_RD_PHYSICAL_MIN(0),
+		HID_RD_PHYSICAL_MAX(0),
+		HID_RD_REPORT_ID(INPUT_REP_REF_BUTTONS_ID),
+		MOUSE_REP_WHEEL(HID_RD_INPUT)
+		HID_RD_END_COLLECTION,
+		HID_RD_COLLECTION(HID_RD_LOGICAL),
+		HID_RD_REPORT_ID(FEATURE_REP_REF_RES_MULT_ID),
+		HID_RD_PHYSICAL_MIN(1),
+		HID_RD_PHYSICAL_MAX(MOUSE_SCROLL_RES_MULTIPLIER),
+		MOUSE_REP_PAN_RES(HID_RD_FEATURE)
+		HID_RD_PHYSICAL_MIN(0),
+		HID_RD_PHYSICAL_MAX(0),
+		HID_RD_REPORT_ID(INPUT_REP_REF_BUTTONS_ID),
+		MOUSE_REP_PAN(HID_RD_INPUT)
+		HID_RD_END_COLLECTION,
+#else
+		MOUSE_REP_WHEEL(HID_RD_INPUT)
+		MOUSE_REP_PAN(HID_RD_INPUT)
+#endif
+		HID_RD_END_COLLECTION,
 
+#if !defined(CONFIG_APP_HID_COMBINED_REPORT)
 		/* Report ID 2: Mouse motion */
-		0x85, 0x02,       /* Report Id 2 */
-		0x09, 0x01,       /* Usage (Pointer) */
-		0xA1, 0x00,       /* Collection (Physical) */
-		0x75, 0x0C,       /* Report Size (12) */
-		0x95, 0x02,       /* Report Count (2) */
-		0x05, 0x01,       /* Usage Page (Generic Desktop) */
-		0x09, 0x30,       /* Usage (X) */
-		0x09, 0x31,       /* Usage (Y) */
-		0x16, 0x01, 0xF8, /* Logical maximum (2047) */
-		0x26, 0xFF, 0x07, /* Logical minimum (-2047) */
-		0x81, 0x06,       /* Input (Data, Variable, Relative) */
-		0xC0,             /* End Collection (Physical) */
-		0xC0,             /* End Collection (Application) */
+		HID_RD_REPORT_ID(INPUT_REP_REF_MOVEMENT_ID),
+		HID_RD_USAGE_PAGE(HID_PAGE_GENERIC_DESKTOP),
+		HID_RD_USAGE(HID_USAGE_GD_POINTER),
+		HID_RD_COLLECTION(HID_RD_PHYSICAL),
+		MOUSE_REP_MOTION(HID_RD_INPUT)
+		HID_RD_END_COLLECTION,
+#endif
+		HID_RD_END_COLLECTION,
 
 		/* Report ID 3: Advanced buttons */
-		0x05, 0x0C,       /* Usage Page (Consumer) */
-		0x09, 0x01,       /* Usage (Consumer Control) */
-		0xA1, 0x01,       /* Collection (Application) */
-		0x85, 0x03,       /* Report Id (3) */
-		0x15, 0x00,       /* Logical minimum (0) */
-		0x25, 0x01,       /* Logical maximum (1) */
-		0x75, 0x01,       /* Report Size (1) */
-		0x95, 0x01,       /* Report Count (1) */
-
-		0x09, 0xCD,       /* Usage (Play/Pause) */
-		0x81, 0x06,       /* Input (Data,Value,Relative,Bit Field) */
-		0x0A, 0x83, 0x01, /* Usage (Consumer Control Configuration) */
-		0x81, 0x06,       /* Input (Data,Value,Relative,Bit Field) */
-		0x09, 0xB5,       /* Usage (Scan Next Track) */
-		0x81, 0x06,       /* Input (Data,Value,Relative,Bit Field) */
-		0x09, 0xB6,       /* Usage (Scan Previous Track) */
-		0x81, 0x06,       /* Input (Data,Value,Relative,Bit Field) */
-
-		0x09, 0xEA,       /* Usage (Volume Down) */
-		0x81, 0x06,       /* Input (Data,Value,Relative,Bit Field) */
-		0x09, 0xE9,       /* Usage (Volume Up) */
-		0x81, 0x06,       /* Input (Data,Value,Relative,Bit Field) */
-		0x0A, 0x25, 0x02, /* Usage (AC Forward) */
-		0x81, 0x06,       /* Input (Data,Value,Relative,Bit Field) */
-		0x0A, 0x24, 0x02, /* Usage (AC Back) */
-		0x81, 0x06,       /* Input (Data,Value,Relative,Bit Field) */
-		0xC0              /* End Collection */
+		HID_RD_USAGE_PAGE(HID_PAGE_CONSUMER),
+		HID_RD_USAGE(HID_USAGE_CONSUMER_CONTROL),
+		HID_RD_COLLECTION(HID_RD_APPLICATION),
+		HID_RD_REPORT_ID(INPUT_REP_REF_MPLAYER_ID),
+		MOUSE_REP_MEDIA(HID_RD_INPUT)
+		HID_RD_END_COLLECTION,
 	};
 
 	hids_init_param.rep_map.data = report_map;
@@ -586,141 +699,1086 @@ static void hid_init(void)
 	hids_inp_rep = &hids_init_param.inp_rep_group_init.reports[0];
 	hids_inp_rep->size = INPUT_REP_BUTTONS_LEN;
 	hids_inp_rep->id = INPUT_REP_REF_BUTTONS_ID;
+#if defined(CONFIG_APP_HID_COMBINED_REPORT)
+	hids_inp_rep->handler = hids_motion_notify_handler;
+#endif
 	hids_init_param.inp_rep_group_init.cnt++;
 
+#if !defined(CONFIG_APP_HID_COMBINED_REPORT)
 	hids_inp_rep++;
 	hids_inp_rep->size = INPUT_REP_MOVEMENT_LEN;
 	hids_inp_rep->id = INPUT_REP_REF_MOVEMENT_ID;
 	hids_inp_rep->rep_mask = mouse_movement_mask;
+	hids_inp_rep->handler = hids_motion_notify_handler;
 	hids_init_param.inp_rep_group_init.cnt++;
+#endif
 
 	hids_inp_rep++;
 	hids_inp_rep->size = INPUT_REP_MEDIA_PLAYER_LEN;
 	hids_inp_rep->id = INPUT_REP_REF_MPLAYER_ID;
 	hids_init_param.inp_rep_group_init.cnt++;
 
+#if defined(CONFIG_APP_HID_HIRES_SCROLL)
+	hids_feat_rep = &hids_init_param.feat_rep_group_init.reports[FEATURE_REP_RES_MULT_INDEX];
+	hids_feat_rep->size = FEATURE_REP_RES_MULT_LEN;
+	hids_feat_rep->id = FEATURE_REP_REF_RES_MULT_ID;
+	hids_feat_rep->handler = res_mult_handler;
+	hids_init_param.feat_rep_group_init.cnt++;
+#endif
+
 	hids_init_param.is_mouse = true;
 	hids_init_param.pm_evt_handler = hids_pm_evt_handler;
+#if defined(CONFIG_APP_HID_SUSPEND)
+	hids_init_param.cp_evt_handler = hids_cp_evt_handler;
+#endif
 
 	err = bt_hids_init(&hids_obj, &hids_init_param);
 	__ASSERT(err == 0, "HIDS initialization failed\n");
 }
 
 
-static void mouse_movement_send(int16_t x_delta, int16_t y_delta)
+static void tx_age_push(struct bt_conn *conn)
 {
-	for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
+	struct conn_mode *mode = conn_mode_get(conn);
+	k_spinlock_key_t key;
 
-		if (!conn_mode[i].conn) {
-			continue;
-		}
+	if (!mode) {
+		return;
+	}
 
-		if (conn_mode[i].in_boot_mode) {
-			x_delta = MAX(MIN(x_delta, SCHAR_MAX), SCHAR_MIN);
-			y_delta = MAX(MIN(y_delta, SCHAR_MAX), SCHAR_MIN);
+	key = k_spin_lock(&tx_age_lock);
+	mode->tx_sample_ts[mode->tx_head++ % TX_AGE_RING_SIZE] = tx_sample_ts;
+	if ((uint8_t)(mode->tx_head - mode->tx_tail) > TX_AGE_RING_SIZE) {
+		mode->tx_tail++;
+	}
+	k_spin_unlock(&tx_age_lock, key);
+}
 
-			bt_hids_boot_mouse_inp_rep_send(&hids_obj,
-							     conn_mode[i].conn,
-							     NULL,
-							     (int8_t) x_delta,
-							     (int8_t) y_delta,
-							     NULL);
-		} else {
-			uint8_t x_buff[2];
-			uint8_t y_buff[2];
-			uint8_t buffer[INPUT_REP_MOVEMENT_LEN];
+/* Drop the entry of a notification that could not be sent. */
+static void tx_age_cancel(struct bt_conn *conn)
+{
+	struct conn_mode *mode = conn_mode_get(conn);
+	k_spinlock_key_t key;
 
-			int16_t x = MAX(MIN(x_delta, 0x07ff), -0x07ff);
-			int16_t y = MAX(MIN(y_delta, 0x07ff), -0x07ff);
+	if (!mode) {
+		return;
+	}
 
-			/* Convert to little-endian. */
-			sys_put_le16(x, x_buff);
-			sys_put_le16(y, y_buff);
+	key = k_spin_lock(&tx_age_lock);
+	if (mode->tx_head != mode->tx_tail) {
+		mode->tx_head--;
+	}
+	k_spin_unlock(&tx_age_lock, key);
+}
 
-			/* Encode report. */
-			BUILD_ASSERT(sizeof(buffer) == 3,
-					 "Only 2 axis, 12-bit each, are supported");
+static void tx_age_pop(struct bt_conn *conn)
+{
+	struct conn_mode *mode = conn_mode_get(conn);
+	uint32_t timestamp = 0;
+	k_spinlock_key_t key;
 
-			buffer[0] = x_buff[0];
-			buffer[1] = (y_buff[0] << 4) | (x_buff[1] & 0x0f);
-			buffer[2] = (y_buff[1] << 4) | (y_buff[0] >> 4);
+	if (!mode) {
+		return;
+	}
 
+	key = k_spin_lock(&tx_age_lock);
+	if (mode->tx_head != mode->tx_tail) {
+		timestamp = mode->tx_sample_ts[mode->tx_tail++ % TX_AGE_RING_SIZE];
+	}
+	k_spin_unlock(&tx_age_lock, key);
 
-			bt_hids_inp_rep_send(&hids_obj, conn_mode[i].conn,
-						  INPUT_REP_MOVEMENT_INDEX,
-						  buffer, sizeof(buffer), NULL);
-		}
+	if (timestamp) {
+		stats_hid_report_age(k_cyc_to_us_floor32(k_cycle_get_32() - timestamp));
 	}
 }
 
-
-static void mouse_handler(struct k_work *work)
+static void first_report_check(struct bt_conn *conn)
 {
-	struct mouse_pos pos;
+	struct conn_mode *mode = conn_mode_get(conn);
+	uint32_t time_us;
 
-	while (!k_msgq_get(&hids_queue, &pos, K_NO_WAIT)) {
-		mouse_movement_send(pos.x_val, pos.y_val);
+	if (!mode || !mode->connected_ts) {
+		return;
 	}
+
+	time_us = k_cyc_to_us_floor32(k_cycle_get_32() - mode->connected_ts);
+	mode->connected_ts = 0;
+
+	printk("First report delivered %u ms after connection\n", time_us / USEC_PER_MSEC);
+	stats_bt_first_report(time_us);
 }
 
-#if defined(CONFIG_BT_HIDS_SECURITY_ENABLED)
-static void pairing_complete(struct bt_conn *conn, bool bonded)
+static atomic_val_t tx_in_flight_get(void)
 {
-	char addr[BT_ADDR_LE_STR_LEN];
+	atomic_val_t count = 0;
 
-	bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
+	for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
+		if (conn_mode[i].conn) {
+			count += atomic_get(&conn_mode[i].tx_in_flight);
+		}
+	}
 
-	printk("Pairing completed: %s, bonded: %d\n", addr, bonded);
+	return count;
 }
 
+static void tx_in_flight_inc(struct bt_conn *conn)
+{
+	struct conn_mode *mode = conn_mode_get(conn);
 
-static void pairing_failed(struct bt_conn *conn, enum bt_security_err reason)
+	if (mode) {
+		atomic_inc(&mode->tx_in_flight);
+	}
+}
+
+static void tx_in_flight_dec(struct bt_conn *conn)
 {
-	char addr[BT_ADDR_LE_STR_LEN];
-	struct pairing_data_mitm pairing_data;
+	struct conn_mode *mode = conn_mode_get(conn);
+	atomic_val_t count;
 
-	if (k_msgq_peek(&mitm_queue, &pairing_data) != 0) {
+	if (!mode) {
 		return;
 	}
 
-	if (pairing_data.conn == conn) {
-		bt_conn_unref(pairing_data.conn);
-		k_msgq_get(&mitm_queue, &pairing_data, K_NO_WAIT);
+	/* The count is cleared on disconnection, late completions are ignored. */
+	do {
+		count = atomic_get(&mode->tx_in_flight);
+		if (!count) {
+			return;
+		}
+	} while (!atomic_cas(&mode->tx_in_flight, count, count - 1));
+}
+
+static void tx_retry_handler(struct k_work *work)
+{
+	if (atomic_cas(&tx_deferred, true, false)) {
+		k_work_submit(&hids_work);
 	}
+}
 
-	bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
+static K_WORK_DELAYABLE_DEFINE(tx_retry_work, tx_retry_handler);
 
-	printk("Pairing failed conn: %s, reason %d\n", addr, reason);
+/* Run the report work again once a TX buffer is released, or after a
+ * short delay for a failed send, for which no release may ever come.
+ */
+static void tx_defer(void)
+{
+	atomic_set(&tx_deferred, true);
+	k_work_schedule(&tx_retry_work, K_MSEC(TX_RETRY_DELAY_MS));
 }
 
+static void hids_tx_complete(struct bt_conn *conn, void *user_data)
+{
+	struct conn_mode *mode = conn_mode_get(conn);
 
-static struct bt_conn_auth_info_cb conn_auth_info_callbacks = {
-	.pairing_complete = pairing_complete,
-	.pairing_failed = pairing_failed
-};
-#else
-static struct bt_conn_auth_info_cb conn_auth_info_callbacks;
-#endif /* defined(CONFIG_BT_HIDS_SECURITY_ENABLED) */
+	if (mode) {
+		atomic_inc(&mode->tx_done);
+	}
 
-void button_changed(uint32_t button_state, uint32_t has_changed)
-{
-	bool data_to_send = false;
-	struct mouse_pos pos;
-	uint32_t buttons = button_state & has_changed;
+	tx_in_flight_dec(conn);
+	stats_boot_mark(STATS_BOOT_FIRST_REPORT);
+	first_report_check(conn);
 
-	memset(&pos, 0, sizeof(struct mouse_pos));
+	tx_age_pop(conn);
+	conn_sync_tx_complete(conn);
 
-	if (buttons & KEY_LEFT_MASK) {
-		pos.x_val -= MOVEMENT_SPEED;
-		printk("%s(): left\n", __func__);
-		data_to_send = true;
+	if (atomic_cas(&tx_deferred, true, false)) {
+		k_work_submit(&hids_work);
 	}
-	if (buttons & KEY_UP_MASK) {
-		pos.y_val -= MOVEMENT_SPEED;
-		printk("%s(): up\n", __func__);
-		data_to_send = true;
+}
+
+static bool hids_rep_subscribed(struct bt_conn *conn, uint8_t att_ind)
+{
+	return bt_gatt_is_subscribed(conn, &hids_obj.gp.svc.attrs[att_ind], BT_GATT_CCC_NOTIFY);
+}
+
+/* Only a send that failed for lack of buffers is retried, other errors
+ * would fail again. The report is dropped and counts as delivered.
+ */
+static int hids_send_result(int err)
+{
+	if ((err == -ENOMEM) || (err == -ENOBUFS)) {
+		tx_defer();
+		return err;
 	}
-	if (buttons & KEY_RIGHT_MASK) {
+
+	printk("Input report dropped (err %d)\n", err);
+
+	return 0;
+}
+
+static int hids_inp_rep_send(struct bt_conn *conn, uint8_t rep_index,
+			     const uint8_t *rep, uint8_t len)
+{
+	int err;
+
+	/* A report the host did not subscribe to counts as delivered. */
+	if (!hids_rep_subscribed(conn, hids_obj.inp_rep_group.reports[rep_index].att_ind)) {
+		return 0;
+	}
+
+	tx_in_flight_inc(conn);
+	tx_age_push(conn);
+
+	err = bt_hids_inp_rep_send(&hids_obj, conn, rep_index, rep, len, hids_tx_complete);
+	if (err) {
+		tx_age_cancel(conn);
+		tx_in_flight_dec(conn);
+		return hids_send_result(err);
+	}
+
+	stats_hid_notified(hids_obj.inp_rep_group.reports[rep_index].id);
+
+	return 0;
+}
+
+static int hids_boot_mouse_send(struct bt_conn *conn, const uint8_t *buttons,
+				int8_t x_delta, int8_t y_delta)
+{
+	int err;
+
+	if (!hids_rep_subscribed(conn, hids_obj.boot_mouse_inp_rep.att_ind)) {
+		return 0;
+	}
+
+	tx_in_flight_inc(conn);
+	tx_age_push(conn);
+
+	err = bt_hids_boot_mouse_inp_rep_send(&hids_obj, conn, buttons, x_delta, y_delta,
+					      hids_tx_complete);
+	if (err) {
+		tx_age_cancel(conn);
+		tx_in_flight_dec(conn);
+		return hids_send_result(err);
+	}
+
+	stats_hid_notified(STATS_HID_BOOT_REPORT_ID);
+
+	return 0;
+}
+
+/* Keep the motion of a connection that cannot receive reports yet. */
+static void motion_pend(struct conn_mode *mode, int16_t x_delta, int16_t y_delta)
+{
+	mode->pend_x = CLAMP(mode->pend_x + x_delta, -MOUSE_MOVEMENT_MAX, MOUSE_MOVEMENT_MAX);
+	mode->pend_y = CLAMP(mode->pend_y + y_delta, -MOUSE_MOVEMENT_MAX, MOUSE_MOVEMENT_MAX);
+}
+
+#if !defined(CONFIG_APP_HID_COMBINED_REPORT)
+static int mouse_movement_conn_send(struct conn_mode *mode, int16_t x_delta, int16_t y_delta)
+{
+	if (mode->in_boot_mode) {
+		x_delta = MAX(MIN(x_delta, SCHAR_MAX), SCHAR_MIN);
+		y_delta = MAX(MIN(y_delta, SCHAR_MAX), SCHAR_MIN);
+
+		return hids_boot_mouse_send(mode->conn,
+					    &btn_rep.state,
+					    (int8_t) x_delta,
+					    (int8_t) y_delta);
+	} else {
+		uint8_t buffer[INPUT_REP_MOVEMENT_LEN] = {0};
+
+		mouse_report_motion_encode(buffer, x_delta, y_delta);
+
+		return hids_inp_rep_send(mode->conn,
+					 INPUT_REP_MOVEMENT_INDEX,
+					 buffer, sizeof(buffer));
+	}
+}
+
+static void mouse_movement_send(int16_t x_delta, int16_t y_delta)
+{
+	for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
+
+		if (!conn_is_routed(i)) {
+			continue;
+		}
+
+		if (!conn_mode[i].ready) {
+			motion_pend(&conn_mode[i], x_delta, y_delta);
+			continue;
+		}
+
+		mouse_movement_conn_send(&conn_mode[i], x_delta, y_delta);
+	}
+}
+#endif /* !defined(CONFIG_APP_HID_COMBINED_REPORT) */
+
+static int mouse_buttons_send(struct conn_mode *mode, uint8_t state, int8_t wheel, int8_t pan,
+			      int16_t x_delta, int16_t y_delta)
+{
+	if (mode->in_boot_mode) {
+		/* Boot protocol mouse report carries no scroll data. */
+		return hids_boot_mouse_send(mode->conn, &state,
+					    CLAMP(x_delta, SCHAR_MIN, SCHAR_MAX),
+					    CLAMP(y_delta, SCHAR_MIN, SCHAR_MAX));
+	} else {
+		uint8_t buffer[INPUT_REP_BUTTONS_LEN] = {0};
+
+		mouse_report_buttons_encode(buffer, state, wheel, pan, x_delta, y_delta);
+
+		return hids_inp_rep_send(mode->conn,
+					 INPUT_REP_BUTTONS_INDEX,
+					 buffer, sizeof(buffer));
+	}
+}
+
+/* Get the part of the accumulated scroll that can be reported, fractional
+ * detents are kept for hosts that did not enable the resolution multiplier.
+ */
+static int8_t scroll_reportable(int16_t acc, bool hires)
+{
+	if (!hires) {
+		acc /= MOUSE_SCROLL_RES_MULTIPLIER;
+	}
+
+	return CLAMP(acc, -SCHAR_MAX, SCHAR_MAX);
+}
+
+static int16_t scroll_consumed(int8_t value, bool hires)
+{
+	return hires ? value : value * MOUSE_SCROLL_RES_MULTIPLIER;
+}
+
+/* Send the buttons report of a connection together with its accumulated
+ * scroll. Without the force flag the report is sent only if there is
+ * scroll to report.
+ */
+static int mouse_buttons_conn_send(struct conn_mode *mode, uint8_t state, bool force,
+				   int16_t x_delta, int16_t y_delta)
+{
+	k_spinlock_key_t key;
+	int8_t wheel;
+	int8_t pan;
+	int err;
+
+	key = k_spin_lock(&btn_rep.lock);
+	if (mode->in_boot_mode) {
+		mode->wheel = 0;
+		mode->pan = 0;
+	}
+	wheel = scroll_reportable(mode->wheel, mode->hires_wheel);
+	pan = scroll_reportable(mode->pan, mode->hires_pan);
+	k_spin_unlock(&btn_rep.lock, key);
+
+	if (!force && !wheel && !pan) {
+		return 0;
+	}
+
+	/* Scroll alone waits for the previous buttons report, so the ticks
+	 * of a connection interval are combined into a single report.
+	 */
+	if (!force && ((atomic_get(&mode->tx_done) - mode->btn_tx_done) < 0)) {
+		tx_defer();
+		return 0;
+	}
+
+	err = mouse_buttons_send(mode, state, wheel, pan, x_delta, y_delta);
+	if (err) {
+		/* Keep the state, it is combined with the next changes. */
+		return err;
+	}
+
+	/* Completions read first, a completion in between only lets the
+	 * next scroll go out one notification early.
+	 */
+	mode->btn_tx_done = atomic_get(&mode->tx_done);
+	mode->btn_tx_done += atomic_get(&mode->tx_in_flight);
+
+	key = k_spin_lock(&btn_rep.lock);
+	mode->wheel -= scroll_consumed(wheel, mode->hires_wheel);
+	mode->pan -= scroll_consumed(pan, mode->hires_pan);
+	k_spin_unlock(&btn_rep.lock, key);
+
+	return 0;
+}
+
+/* Send the buttons report to all connections, with motion in the combined
+ * report layout. Only button changes, motion and accumulated scroll are
+ * transmitted.
+ */
+static void mouse_buttons_report(int16_t x_delta, int16_t y_delta)
+{
+	uint8_t state = btn_rep.state;
+	bool force = (state != btn_rep.sent) || x_delta || y_delta;
+	bool failed = false;
+
+	for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
+		if (!conn_is_routed(i)) {
+			continue;
+		}
+
+		/* The button state is sent in full once the connection is ready. */
+		if (!conn_mode[i].ready) {
+			motion_pend(&conn_mode[i], x_delta, y_delta);
+			continue;
+		}
+
+		if (mouse_buttons_conn_send(&conn_mode[i], state, force, x_delta, y_delta)) {
+			failed = true;
+		}
+	}
+
+	if (!failed) {
+		btn_rep.sent = state;
+	}
+}
+
+#if defined(CONFIG_APP_HID_COMBINED_REPORT)
+static void mouse_movement_send(int16_t x_delta, int16_t y_delta)
+{
+	mouse_buttons_report(x_delta, y_delta);
+}
+#endif
+
+static void mouse_buttons_process(void)
+{
+	mouse_buttons_report(0, 0);
+}
+
+/* Send the report to the hosts that did not accept it yet. The hosts that
+ * lost the focus get the release report instead, so no key stays held.
+ *
+ * @retval 0 once all hosts accepted the report, -ENOTCONN if there is no
+ *         host, otherwise a (negative) error code of a failed send.
+ */
+static int mouse_media_send(uint8_t report)
+{
+	int ret = -ENOTCONN;
+	int err;
+
+	/* The report is the bitmask of enum mouse_media_key values. */
+	BUILD_ASSERT(INPUT_REP_MEDIA_PLAYER_LEN == sizeof(report));
+	BUILD_ASSERT(REP_PLAY_PAUSE_OFFSET == MOUSE_MEDIA_PLAY_PAUSE);
+	BUILD_ASSERT(REP_AC_BACK_OFFSET == MOUSE_MEDIA_AC_BACK);
+
+	for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
+		struct conn_mode *mode = &conn_mode[i];
+		uint8_t host_report = conn_is_routed(i) ? report : 0;
+
+		/* Boot protocol hosts have no media player report. */
+		if (!mode->conn || !mode->ready || mode->in_boot_mode) {
+			continue;
+		}
+
+		if (conn_is_routed(i) && (ret == -ENOTCONN)) {
+			ret = 0;
+		}
+
+		if (mode->media_sent == host_report) {
+			continue;
+		}
+
+		err = hids_inp_rep_send(mode->conn, INPUT_REP_MPLAYER_INDEX,
+					&host_report, sizeof(host_report));
+		if (err) {
+			ret = err;
+			continue;
+		}
+
+		mode->media_sent = host_report;
+	}
+
+	return ret;
+}
+
+static void mouse_media_process(void)
+{
+	k_spinlock_key_t key;
+	uint8_t pressed;
+	uint8_t report;
+	bool more = false;
+	int err;
+
+	key = k_spin_lock(&media_rep.lock);
+	if (!media_rep.pressed) {
+		/* Batch all pending keys in a single click. */
+		for (size_t i = 0; i < ARRAY_SIZE(media_rep.pending); i++) {
+			if (media_rep.pending[i]) {
+				media_rep.pending[i]--;
+				media_rep.pressed |= BIT(i);
+			}
+		}
+	}
+	pressed = media_rep.pressed;
+	report = media_rep.released ? 0 : pressed;
+	k_spin_unlock(&media_rep.lock, key);
+
+	/* Nothing to send, leave the TX buffers to the motion. */
+	if (!pressed) {
+		return;
+	}
+
+	/* Motion has strict priority over media keys when TX buffers are short. */
+	if (k_msgq_num_used_get(&hids_queue) ||
+	    (tx_in_flight_get() > (CONFIG_BT_ATT_TX_COUNT - MEDIA_TX_RESERVE))) {
+		tx_defer();
+		return;
+	}
+
+	/* The click moves on once every host accepted its report, a pressed
+	 * state is always followed by the matching release report.
+	 */
+	err = mouse_media_send(report);
+	if (err && (err != -ENOTCONN)) {
+		return;
+	}
+
+	key = k_spin_lock(&media_rep.lock);
+	if (err) {
+		/* Nobody to report to, do not replay stale clicks later. */
+		memset(media_rep.pending, 0, sizeof(media_rep.pending));
+		media_rep.pressed = 0;
+		media_rep.released = false;
+	} else if (!media_rep.released) {
+		media_rep.released = true;
+	} else {
+		media_rep.pressed = 0;
+		media_rep.released = false;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(media_rep.pending); i++) {
+		more = more || media_rep.pending[i];
+	}
+	more = more || media_rep.pressed;
+	k_spin_unlock(&media_rep.lock, key);
+
+	if (more) {
+		k_work_submit(&hids_work);
+	}
+}
+
+static bool conn_ready_check(const struct conn_mode *mode)
+{
+	uint8_t att_ind;
+
+	if (IS_ENABLED(CONFIG_BT_HIDS_DEFAULT_PERM_RW_ENCRYPT) &&
+	    (bt_conn_get_security(mode->conn) < BT_SECURITY_L2)) {
+		return false;
+	}
+
+	if (mode->in_boot_mode) {
+		att_ind = hids_obj.boot_mouse_inp_rep.att_ind;
+	} else {
+		att_ind = hids_obj.inp_rep_group.reports[INPUT_REP_MOTION_INDEX].att_ind;
+	}
+
+	return hids_rep_subscribed(mode->conn, att_ind);
+}
+
+/* Send the motion, buttons and scroll kept while the connection was not
+ * ready.
+ */
+static int conn_ready_flush(struct conn_mode *mode)
+{
+	int err;
+
+#if defined(CONFIG_APP_HID_COMBINED_REPORT)
+	err = mouse_buttons_conn_send(mode, btn_rep.state, true, mode->pend_x, mode->pend_y);
+	if (err) {
+		return err;
+	}
+#else
+	if (mode->pend_x || mode->pend_y) {
+		err = mouse_movement_conn_send(mode, mode->pend_x, mode->pend_y);
+		if (err) {
+			return err;
+		}
+
+		mode->pend_x = 0;
+		mode->pend_y = 0;
+	}
+
+	err = mouse_buttons_conn_send(mode, btn_rep.state, true, 0, 0);
+	if (err) {
+		return err;
+	}
+#endif
+
+	mode->pend_x = 0;
+	mode->pend_y = 0;
+
+	return 0;
+}
+
+/* Mark the connections on which security and notifications got enabled
+ * as ready and flush their input.
+ */
+static void conn_ready_process(void)
+{
+	for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
+		struct conn_mode *mode = &conn_mode[i];
+
+		if (!mode->conn || mode->ready || !conn_ready_check(mode)) {
+			continue;
+		}
+
+		/* On failure the flush is retried with the next run of the work. */
+		if (conn_is_routed(i) && conn_ready_flush(mode)) {
+			continue;
+		}
+
+		mode->ready = true;
+	}
+}
+
+#if defined(CONFIG_APP_HID_SUSPEND)
+static int host_conn_param_set(struct conn_mode *mode, bool suspended)
+{
+	const struct bt_le_conn_param *param = suspended ?
+		BT_LE_CONN_PARAM(HOST_SUSPEND_INT_MIN, HOST_SUSPEND_INT_MAX,
+				 HOST_SUSPEND_LATENCY, HOST_SUSPEND_TIMEOUT) :
+		BT_LE_CONN_PARAM(HOST_ACTIVE_INT_MIN, HOST_ACTIVE_INT_MAX,
+				 HOST_ACTIVE_LATENCY, HOST_ACTIVE_TIMEOUT);
+	int err;
+
+	mode->suspended = suspended;
+	/* A pending wake up is not measured across a new update. */
+	mode->wake_ts = 0;
+
+	err = bt_conn_le_param_update(mode->conn, param);
+	if (err) {
+		printk("Connection parameters update failed (err %d)\n", err);
+	}
+
+	return err;
+}
+
+/* Check if a suspend request of an unknown host may relax a connection. */
+static bool host_suspend_allowed(size_t idx)
+{
+	const struct conn_mode *mode = &conn_mode[idx];
+
+#if defined(CONFIG_APP_HID_FOCUS)
+	/* The focused host is in use. */
+	if (idx == focus_idx) {
+		return false;
+	}
+#endif
+
+	return !mode->input_ts ||
+	       ((k_uptime_get_32() - mode->input_ts) >= HOST_SUSPEND_HOLDOFF_MS);
+}
+
+/* Apply the suspend state requested through the HID Control Point. The
+ * request does not tell the host that made it, so the hosts in use are
+ * kept active.
+ */
+static void host_suspend_process(void)
+{
+	atomic_val_t req = atomic_set(&host_suspend_req, HOST_REQ_NONE);
+	bool suspend = (req == HOST_REQ_SUSPEND);
+
+	if (req == HOST_REQ_NONE) {
+		return;
+	}
+
+	for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
+		if (!conn_mode[i].conn || (conn_mode[i].suspended == suspend)) {
+			continue;
+		}
+
+		if (suspend && !host_suspend_allowed(i)) {
+			printk("Host %zu in use, suspend ignored\n", i);
+			continue;
+		}
+
+		printk("Host %zu %s suspend\n", i, suspend ? "entered" : "exited");
+		host_conn_param_set(&conn_mode[i], suspend);
+	}
+}
+
+/* Wake up the suspended hosts that are about to receive input. The input
+ * report itself is the remote wake up signal, the connection is switched
+ * back to low latency for the reports that follow.
+ */
+static void host_wake_process(void)
+{
+	if (!k_msgq_num_used_get(&hids_queue) && (btn_rep.state == btn_rep.sent)) {
+		return;
+	}
+
+	for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
+		uint32_t wake_ts = MAX(k_cycle_get_32(), 1);
+
+		if (!conn_is_routed(i)) {
+			continue;
+		}
+
+		conn_mode[i].input_ts = MAX(k_uptime_get_32(), 1);
+
+		if (!conn_mode[i].suspended) {
+			continue;
+		}
+
+		printk("Waking up host %zu\n", i);
+		if (!host_conn_param_set(&conn_mode[i], false)) {
+			conn_mode[i].wake_ts = wake_ts;
+		}
+	}
+}
+#endif /* defined(CONFIG_APP_HID_SUSPEND) */
+
+#if defined(CONFIG_APP_HID_FOCUS)
+static int focus_next_get(int from)
+{
+	for (size_t n = 1; n <= CONFIG_BT_HIDS_MAX_CLIENT_COUNT; n++) {
+		size_t i = (from + n + CONFIG_BT_HIDS_MAX_CLIENT_COUNT) %
+			   CONFIG_BT_HIDS_MAX_CLIENT_COUNT;
+
+		if (conn_mode[i].conn) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static void focus_process(void)
+{
+	int req = atomic_set(&focus_req, FOCUS_REQ_NONE);
+	int next = focus_idx;
+	int old = focus_idx;
+	k_spinlock_key_t key;
+
+	if (req == FOCUS_REQ_NEXT) {
+		next = focus_next_get(focus_idx);
+	} else if ((req >= 0) && conn_mode[req].conn) {
+		next = req;
+	}
+
+	if ((next < 0) || !conn_mode[next].conn) {
+		next = focus_next_get(-1);
+	}
+
+	if (next == old) {
+		return;
+	}
+
+	/* Release the buttons on the host losing the focus, so none stays
+	 * pressed there, and drop its pending scroll.
+	 */
+	if ((old >= 0) && conn_mode[old].conn) {
+		key = k_spin_lock(&btn_rep.lock);
+		conn_mode[old].wheel = 0;
+		conn_mode[old].pan = 0;
+		k_spin_unlock(&btn_rep.lock, key);
+
+		(void)mouse_buttons_send(&conn_mode[old], 0, 0, 0, 0, 0);
+	}
+
+	focus_idx = next;
+
+	if (next < 0) {
+		return;
+	}
+
+	/* The focused host is the first one to reconnect. */
+	bond_cache_touch(bt_conn_get_dst(conn_mode[next].conn));
+
+	/* Force a buttons report, the new host gets the current state. */
+	btn_rep.sent = ~btn_rep.state;
+
+	printk("Input focus on host %d\n", next);
+}
+#endif /* defined(CONFIG_APP_HID_FOCUS) */
+
+static void mouse_handler(struct k_work *work)
+{
+	struct mouse_pos pos;
+	struct mouse_pos next;
+
+#if defined(CONFIG_APP_HID_FOCUS)
+	focus_process();
+#endif
+	conn_ready_process();
+#if defined(CONFIG_APP_HID_SUSPEND)
+	/* The input of this run holds off a suspend request. */
+	host_wake_process();
+	host_suspend_process();
+#endif
+
+	while (!k_msgq_get(&hids_queue, &pos, K_NO_WAIT)) {
+		/* Merge queued samples as long as their sum fits in one report. */
+		while (!k_msgq_peek(&hids_queue, &next) &&
+		       IN_RANGE(pos.x_val + next.x_val, -MOUSE_MOVEMENT_MAX, MOUSE_MOVEMENT_MAX) &&
+		       IN_RANGE(pos.y_val + next.y_val, -MOUSE_MOVEMENT_MAX, MOUSE_MOVEMENT_MAX)) {
+			k_msgq_get(&hids_queue, &next, K_NO_WAIT);
+			pos.x_val += next.x_val;
+			pos.y_val += next.y_val;
+			stats_hid_merged();
+		}
+
+		tx_sample_ts = pos.timestamp;
+		mouse_movement_send(pos.x_val, pos.y_val);
+		tx_sample_ts = 0;
+		stats_hid_report_sent(k_cyc_to_us_floor32(k_cycle_get_32() - pos.timestamp));
+	}
+
+	mouse_buttons_process();
+	mouse_media_process();
+}
+
+#if defined(CONFIG_APP_CONN_SYNC)
+/* Motion accumulated between connection events. */
+static struct {
+	struct k_spinlock lock;
+	int32_t x_val;
+	int32_t y_val;
+	uint32_t timestamp;
+	bool pending;
+} motion_acc;
+
+/* Must be called with the accumulator lock held. */
+static int motion_acc_flush(void)
+{
+	struct mouse_pos pos = {
+		.x_val = motion_acc.x_val,
+		.y_val = motion_acc.y_val,
+		.timestamp = motion_acc.timestamp,
+	};
+	int err;
+
+	if (!motion_acc.pending) {
+		return 0;
+	}
+
+	err = k_msgq_put(&hids_queue, &pos, K_NO_WAIT);
+	stats_msgq_put(STATS_MSGQ_HIDS, &hids_queue, err);
+	if (err) {
+		return err;
+	}
+
+	motion_acc.x_val = 0;
+	motion_acc.y_val = 0;
+	motion_acc.pending = false;
+
+	return 0;
+}
+
+static int motion_acc_add(int16_t x_delta, int16_t y_delta)
+{
+	k_spinlock_key_t key = k_spin_lock(&motion_acc.lock);
+	int err = 0;
+
+	if (motion_acc.pending) {
+		/* Queue the accumulated motion once it fills a report. */
+		if (!IN_RANGE(motion_acc.x_val + x_delta, -MOUSE_MOVEMENT_MAX, MOUSE_MOVEMENT_MAX) ||
+		    !IN_RANGE(motion_acc.y_val + y_delta, -MOUSE_MOVEMENT_MAX, MOUSE_MOVEMENT_MAX)) {
+			err = motion_acc_flush();
+		} else {
+			stats_hid_merged();
+		}
+	}
+
+	if (!err) {
+		if (!motion_acc.pending) {
+			motion_acc.timestamp = k_cycle_get_32();
+			motion_acc.pending = true;
+		}
+
+		motion_acc.x_val += x_delta;
+		motion_acc.y_val += y_delta;
+	}
+
+	k_spin_unlock(&motion_acc.lock, key);
+
+	return err;
+}
+
+/* Called a lead time before each connection event. */
+static void conn_event_trigger(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&motion_acc.lock);
+	bool flushed = motion_acc.pending && !motion_acc_flush();
+
+	k_spin_unlock(&motion_acc.lock, key);
+
+	if (flushed) {
+		k_work_submit(&hids_work);
+	}
+}
+#endif /* defined(CONFIG_APP_CONN_SYNC) */
+
+int mouse_motion_submit(int16_t x_delta, int16_t y_delta)
+{
+	static struct accel_state accel_state;
+	struct mouse_pos pos = {
+		.timestamp = k_cycle_get_32(),
+	};
+	int err;
+
+	accel_apply(&accel_state, &x_delta, &y_delta);
+	if (!x_delta && !y_delta) {
+		/* Sub-count motion, kept in the acceleration remainders. */
+		return 0;
+	}
+
+	airtime_motion_mark();
+
+#if defined(CONFIG_APP_CONN_SYNC)
+	if (conn_sync_active()) {
+		return motion_acc_add(x_delta, y_delta);
+	}
+#endif
+
+	pos.x_val = x_delta;
+	pos.y_val = y_delta;
+
+	err = k_msgq_put(&hids_queue, &pos, K_NO_WAIT);
+	stats_msgq_put(STATS_MSGQ_HIDS, &hids_queue, err);
+	if (err) {
+		return err;
+	}
+
+	k_work_submit(&hids_work);
+
+	return 0;
+}
+
+void mouse_buttons_set(uint8_t state)
+{
+	btn_rep.state = state & MOUSE_BUTTONS_MASK;
+	k_work_submit(&hids_work);
+}
+
+#if defined(CONFIG_APP_HID_FOCUS)
+int mouse_host_select(uint8_t host)
+{
+	if (host >= CONFIG_BT_HIDS_MAX_CLIENT_COUNT) {
+		return -EINVAL;
+	}
+
+	if (!conn_mode[host].conn) {
+		return -ENOTCONN;
+	}
+
+	atomic_set(&focus_req, host);
+	k_work_submit(&hids_work);
+
+	return 0;
+}
+
+void mouse_host_next(void)
+{
+	atomic_set(&focus_req, FOCUS_REQ_NEXT);
+	k_work_submit(&hids_work);
+}
+#endif /* defined(CONFIG_APP_HID_FOCUS) */
+
+int mouse_media_click(enum mouse_media_key key)
+{
+	k_spinlock_key_t lock_key;
+	int err = 0;
+
+	if (key >= MOUSE_MEDIA_KEY_COUNT) {
+		return -EINVAL;
+	}
+
+	lock_key = k_spin_lock(&media_rep.lock);
+	/* Coalesce bursts, such as a held volume key, into a few clicks. */
+	if (media_rep.pending[key] < MEDIA_PENDING_MAX) {
+		media_rep.pending[key]++;
+	} else {
+		err = -ENOBUFS;
+	}
+	k_spin_unlock(&media_rep.lock, lock_key);
+
+	k_work_submit(&hids_work);
+
+	return err;
+}
+
+void mouse_scroll_hires_submit(int16_t wheel, int16_t pan)
+{
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&btn_rep.lock);
+	for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
+		if (!conn_is_routed(i)) {
+			continue;
+		}
+
+		conn_mode[i].wheel = CLAMP(conn_mode[i].wheel + wheel, INT16_MIN, INT16_MAX);
+		conn_mode[i].pan = CLAMP(conn_mode[i].pan + pan, INT16_MIN, INT16_MAX);
+	}
+	k_spin_unlock(&btn_rep.lock, key);
+
+	k_work_submit(&hids_work);
+}
+
+void mouse_scroll_submit(int8_t wheel, int8_t pan)
+{
+	mouse_scroll_hires_submit(wheel * MOUSE_SCROLL_RES_MULTIPLIER,
+				  pan * MOUSE_SCROLL_RES_MULTIPLIER);
+}
+
+#if defined(CONFIG_BT_HIDS_SECURITY_ENABLED)
+static void pairing_complete(struct bt_conn *conn, bool bonded)
+{
+	char addr[BT_ADDR_LE_STR_LEN];
+
+	bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
+
+	printk("Pairing completed: %s, bonded: %d\n", addr, bonded);
+}
+
+
+static void pairing_failed(struct bt_conn *conn, enum bt_security_err reason)
+{
+	char addr[BT_ADDR_LE_STR_LEN];
+	struct pairing_data_mitm pairing_data;
+
+	if (k_msgq_peek(&mitm_queue, &pairing_data) != 0) {
+		return;
+	}
+
+	if (pairing_data.conn == conn) {
+		bt_conn_unref(pairing_data.conn);
+		k_msgq_get(&mitm_queue, &pairing_data, K_NO_WAIT);
+	}
+
+	bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
+
+	printk("Pairing failed conn: %s, reason %d\n", addr, reason);
+}
+
+
+static struct bt_conn_auth_info_cb conn_auth_info_callbacks = {
+	.pairing_complete = pairing_complete,
+	.pairing_failed = pairing_failed
+};
+#else
+static struct bt_conn_auth_info_cb conn_auth_info_callbacks;
+#endif /* defined(CONFIG_BT_HIDS_SECURITY_ENABLED) */
+
+void button_changed(uint32_t button_state, uint32_t has_changed)
+{
+	bool data_to_send = false;
+	struct mouse_pos pos;
+	uint32_t buttons = button_state & has_changed;
+
+	memset(&pos, 0, sizeof(struct mouse_pos));
+
+#if defined(CONFIG_APP_HID_FOCUS)
+	if (((button_state & KEY_HOST_CHORD_MASK) == KEY_HOST_CHORD_MASK) &&
+	    (has_changed & KEY_HOST_CHORD_MASK)) {
+		printk("%s(): next host\n", __func__);
+		mouse_host_next();
+		return;
+	}
+#endif
+
+	if (buttons & KEY_LEFT_MASK) {
+		pos.x_val -= MOVEMENT_SPEED;
+		printk("%s(): left\n", __func__);
+		data_to_send = true;
+	}
+	if (buttons & KEY_UP_MASK) {
+		pos.y_val -= MOVEMENT_SPEED;
+		printk("%s(): up\n", __func__);
+		data_to_send = true;
+	}
+	if (buttons & KEY_RIGHT_MASK) {
 		pos.x_val += MOVEMENT_SPEED;
 		printk("%s(): right\n", __func__);
 		data_to_send = true;
@@ -734,43 +1792,38 @@ void button_changed(uint32_t button_state, uint32_t has_changed)
 	if (data_to_send) {
 		int err;
 
-		err = k_msgq_put(&hids_queue, &pos, K_NO_WAIT);
+		err = mouse_motion_submit(pos.x_val, pos.y_val);
 		if (err) {
 			printk("No space in the queue for button pressed\n");
 			return;
 		}
-		if (k_msgq_num_used_get(&hids_queue) == 1) {
-			k_work_submit(&hids_work);
-		}
 	}
 }
 
 
 void configure_buttons(void)
 {
+#if defined(CONFIG_DK_LIBRARY)
 	int err;
 
 	err = dk_buttons_init(button_changed);
 	if (err) {
 		printk("Cannot init buttons (err: %d)\n", err);
 	}
+#endif
 }
 
 
-static void bas_notify(void)
+static void bonds_load(void)
 {
-	uint8_t battery_level = bt_bas_get_battery_level();
-
-	battery_level--;
+	int err;
 
-	if (!battery_level) {
-		battery_level = 100U;
+	err = bond_cache_load();
+	if (err) {
+		printk("Failed to load the bond cache (err %d)\n", err);
 	}
-
-	bt_bas_set_battery_level(battery_level);
 }
 
-
 int main(void)
 {
 	int err;
@@ -789,6 +1842,10 @@ int main(void)
 	/* DIS initialized at system boot with SYS_INIT macro. */
 	hid_init();
 
+#if defined(CONFIG_APP_CONN_SYNC)
+	conn_sync_init(conn_event_trigger);
+#endif
+
 	err = bt_enable(NULL);
 	if (err) {
 		printk("Bluetooth init failed (err %d)\n", err);
@@ -796,152 +1853,364 @@ int main(void)
 	}
 
 	printk("Bluetooth initialized\n");
+	stats_boot_mark(STATS_BOOT_BT_READY);
+
+	airtime_init();
+
+	err = peer_init();
+	if (err) {
+		printk("Peer init failed (err %d)\n", err);
+	}
+
+	err = ranging_init();
+	if (err) {
+		printk("Ranging init failed (err %d)\n", err);
+	}
+
+	err = service_ddfs_init();
+	if (err) {
+		printk("DDFS init failed (err %d)\n", err);
+	}
+
+	err = angle_init();
+	if (err) {
+		printk("Angle source init failed (err %d)\n", err);
+	}
+
+	stats_msgq_register(STATS_MSGQ_HIDS, &hids_queue);
+	stats_msgq_register(STATS_MSGQ_MITM, &mitm_queue);
 
 	k_work_init(&hids_work, mouse_handler);
-	k_work_init(&adv_work, advertising_process);
 	if (IS_ENABLED(CONFIG_BT_HIDS_SECURITY_ENABLED)) {
 		k_work_init(&pairing_work, pairing_process);
 	}
 
-	if (IS_ENABLED(CONFIG_SETTINGS)) {
+	if (IS_ENABLED(CONFIG_APP_SETTINGS_LOAD_ASYNC)) {
+		/* Only the identity, with the IRK that resolves its private
+		 * addresses, is needed to advertise.
+		 */
+		settings_load_subtree("bt/id");
+		settings_load_subtree("bt/irk");
+		if (IS_ENABLED(CONFIG_BT_GATT_CACHING)) {
+			settings_load_subtree("bt/hash");
+		}
+		settings_commit_subtree("bt");
+	} else if (IS_ENABLED(CONFIG_SETTINGS)) {
 		settings_load();
+		stats_boot_mark(STATS_BOOT_SETTINGS_LOADED);
+	}
+
+	err = advertising_init();
+	if (err) {
+		return 0;
+	}
+
+	if (!IS_ENABLED(CONFIG_APP_SETTINGS_LOAD_ASYNC)) {
+		bonds_load();
 	}
 
 	advertising_start();
 
+	if (IS_ENABLED(CONFIG_APP_SETTINGS_LOAD_ASYNC)) {
+		/* Undirected advertising already runs while the bonds and the
+		 * rest of the settings are loaded.
+		 */
+		settings_load();
+		stats_boot_mark(STATS_BOOT_SETTINGS_LOADED);
+
+		bonds_load();
+
+		/* Restart to direct the advertising to the bonded hosts. */
+		advertising_start();
+	}
+
 	configure_buttons();
 
-	while (1) {
-		k_sleep(K_SECONDS(1));
-		/* Battery level simulation */
-		bas_notify();
+	err = battery_init();
+	if (err) {
+		printk("Battery measurement init failed (err %d)\n", err);
+	}
+
+	/* Everything else runs from callbacks and work items. */
+	return 0;
+}
+
+
+
+int mouse_bt_suspend(void)
+{
+	int err;
+
+	if (bt_suspended) {
+		return -EALREADY;
+	}
+
+	bt_suspended = true;
+	advertising_deinit();
+
+	for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
+		if (conn_mode[i].conn) {
+			(void)bt_conn_disconnect(conn_mode[i].conn,
+						 BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+		}
+	}
+
+	/* Let the disconnection callbacks clean up the connection state. */
+	for (size_t i = 0; is_any_conn_active() && (i < SUSPEND_DISCONNECT_POLLS); i++) {
+		k_sleep(K_MSEC(SUSPEND_DISCONNECT_POLL_MS));
+	}
+
+	k_msgq_purge(&hids_queue);
+
+	err = bt_disable();
+	if (err) {
+		printk("Bluetooth failed to disable (err %d)\n", err);
+		bt_suspended = false;
+		return err;
 	}
+
+	printk("Bluetooth suspended\n");
+
+	return 0;
 }
 
+int mouse_bt_resume(void)
+{
+	uint32_t start = k_cycle_get_32();
+	uint32_t time_us;
+	int err;
+
+	if (!bt_suspended) {
+		return -EALREADY;
+	}
+
+	err = bt_enable(NULL);
+	if (err) {
+		printk("Bluetooth init failed (err %d)\n", err);
+		return err;
+	}
+
+	/* The identity is restored from the settings only if the stack lost it. */
+	if (IS_ENABLED(CONFIG_BT_SETTINGS) && !bt_is_ready()) {
+		settings_load_subtree("bt");
+	}
+
+	err = advertising_init();
+	if (err) {
+		return err;
+	}
+
+	airtime_init();
+
+	bt_suspended = false;
+	advertising_start();
+
+	time_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+	printk("Bluetooth resumed in %u us\n", time_us);
+	stats_bt_resume(time_us);
 
+	return 0;
+}
 
-void test_run_cmd1(int number)
+static int cmd_off(const struct shell *sh, size_t argc, char **argv)
 {
-    printk("Running test\n");
-    struct mouse_pos pos;
-    int err;
-    
-    memset(&pos, 0, sizeof(struct mouse_pos));
+	int err = mouse_bt_suspend();
 
-    pos.x_val -= MOVEMENT_SPEED;
+	if (err) {
+		shell_error(sh, "Suspend failed (err %d)", err);
+	}
 
-    err = k_msgq_put(&hids_queue, &pos, K_NO_WAIT);
-        if (err) {
-            printk("No space in the queue for button pressed\n");
-            return;
-        }
-        if (k_msgq_num_used_get(&hids_queue) == 1) {
-            k_work_submit(&hids_work);
-        }
+	return err;
 }
 
-void test_run_cmd2(int number)
+static int cmd_on(const struct shell *sh, size_t argc, char **argv)
 {
-    printk("Running test\n");
-    struct mouse_pos pos;
-    int err;
-    
-    memset(&pos, 0, sizeof(struct mouse_pos));
+	int err = mouse_bt_resume();
 
-    pos.y_val -= MOVEMENT_SPEED;
+	if (err) {
+		shell_error(sh, "Resume failed (err %d)", err);
+	}
 
-    err = k_msgq_put(&hids_queue, &pos, K_NO_WAIT);
-        if (err) {
-            printk("No space in the queue for button pressed\n");
-            return;
-        }
-        if (k_msgq_num_used_get(&hids_queue) == 1) {
-            k_work_submit(&hids_work);
-        }
+	return err;
 }
 
-void test_run_cmd3(int number)
+static int cmd_hid_move(const struct shell *sh, size_t argc, char **argv)
 {
-    printk("Running test\n");
-    struct mouse_pos pos;
-    int err;
-    memset(&pos, 0, sizeof(struct mouse_pos));
-    pos.x_val += MOVEMENT_SPEED;
-    err = k_msgq_put(&hids_queue, &pos, K_NO_WAIT);
-        if (err) {
-            printk("No space in the queue for button pressed\n");
-            return;
-        }
-        if (k_msgq_num_used_get(&hids_queue) == 1) {
-            k_work_submit(&hids_work);
-        }
+	long x_delta;
+	long y_delta;
+	int err = 0;
+
+	x_delta = shell_strtol(argv[1], 0, &err);
+	y_delta = shell_strtol(argv[2], 0, &err);
+	if (err) {
+		shell_error(sh, "Invalid motion delta");
+		return err;
+	}
+
+	err = mouse_motion_submit(CLAMP(x_delta, INT16_MIN, INT16_MAX),
+				  CLAMP(y_delta, INT16_MIN, INT16_MAX));
+	if (err) {
+		shell_error(sh, "No space in the queue (err %d)", err);
+	}
+
+	return err;
 }
 
-void test_run_cmd4(int number)
+static int cmd_hid_button(const struct shell *sh, size_t argc, char **argv)
 {
-    printk("Running test\n");
-    struct mouse_pos pos;
-    int err;
+	unsigned long state;
+	int err = 0;
 
-    memset(&pos, 0, sizeof(struct mouse_pos));
-    pos.y_val += MOVEMENT_SPEED;
+	state = shell_strtoul(argv[1], 0, &err);
+	if (err || (state & ~MOUSE_BUTTONS_MASK)) {
+		shell_error(sh, "Invalid button mask");
+		return -EINVAL;
+	}
+
+	mouse_buttons_set(state);
 
-    err = k_msgq_put(&hids_queue, &pos, K_NO_WAIT);
-        if (err) {
-            printk("No space in the queue for button pressed\n");
-            return;
-        }
-        if (k_msgq_num_used_get(&hids_queue) == 1) {
-            k_work_submit(&hids_work);
-        }
+	return 0;
 }
 
-void test_run_off(int number)
+static int cmd_hid_scroll(const struct shell *sh, size_t argc, char **argv)
 {
-	bt_disable();
-	main();
+	long wheel;
+	long pan = 0;
+	int err = 0;
+
+	wheel = shell_strtol(argv[1], 0, &err);
+	if (argc > 2) {
+		pan = shell_strtol(argv[2], 0, &err);
+	}
+
+	if (err || !IN_RANGE(wheel, -SCHAR_MAX, SCHAR_MAX) || !IN_RANGE(pan, -SCHAR_MAX, SCHAR_MAX)) {
+		shell_error(sh, "Invalid scroll value");
+		return -EINVAL;
+	}
+
+	mouse_scroll_submit(wheel, pan);
+
+	return 0;
 }
 
-void test_run_dm(void){
-	printk("Starting Distence Measurement\n");
-	struct mouse_pos pos;
-    int err;
+static int cmd_hid_smooth(const struct shell *sh, size_t argc, char **argv)
+{
+	long wheel;
+	long pan = 0;
+	int err = 0;
+
+	wheel = shell_strtol(argv[1], 0, &err);
+	if (argc > 2) {
+		pan = shell_strtol(argv[2], 0, &err);
+	}
+
+	if (err || !IN_RANGE(wheel, INT16_MIN, INT16_MAX) || !IN_RANGE(pan, INT16_MIN, INT16_MAX)) {
+		shell_error(sh, "Invalid scroll value");
+		return -EINVAL;
+	}
+
+	mouse_scroll_hires_submit(wheel, pan);
+
+	return 0;
+}
 
-    memset(&pos, 0, sizeof(struct mouse_pos));
-    pos.y_val = 0x11;
-    pos.x_val = 0x11;
+static int cmd_hid_media(const struct shell *sh, size_t argc, char **argv)
+{
+	static const char * const key_name[MOUSE_MEDIA_KEY_COUNT] = {
+		[MOUSE_MEDIA_PLAY_PAUSE] = "play",
+		[MOUSE_MEDIA_CONFIG]     = "config",
+		[MOUSE_MEDIA_NEXT]       = "next",
+		[MOUSE_MEDIA_PREV]       = "prev",
+		[MOUSE_MEDIA_VOL_DOWN]   = "voldown",
+		[MOUSE_MEDIA_VOL_UP]     = "volup",
+		[MOUSE_MEDIA_AC_FORWARD] = "fwd",
+		[MOUSE_MEDIA_AC_BACK]    = "back",
+	};
+	unsigned long count = 1;
+	uint32_t coalesced = 0;
+	int err = 0;
+	size_t key;
 
-    err = k_msgq_put(&hids_queue, &pos, K_NO_WAIT);
-    if (err) {
-        printk("No space in the queue for button pressed\n");
-        return;
-    }
-    if (k_msgq_num_used_get(&hids_queue) == 1) {
-        k_work_submit(&hids_work);
-    }
+	for (key = 0; key < ARRAY_SIZE(key_name); key++) {
+		if (!strcmp(argv[1], key_name[key])) {
+			break;
+		}
+	}
 
-    struct dm_request req;
+	if (argc > 2) {
+		count = shell_strtoul(argv[2], 0, &err);
+	}
 
-    //Запись адреса устройства
-    for(int i = 0; i < 6; i++){
-        req.bt_addr.a.val[5 -i] = addr12[i];
-    }
+	if ((key >= ARRAY_SIZE(key_name)) || err) {
+		shell_error(sh, "Usage: hid media <play|config|next|prev|voldown|volup|fwd|back> "
+			    "[count]");
+		return -EINVAL;
+	}
 
-    //bt_addr_le_copy(&req.bt_addr, user_data);
-    req.role = DM_ROLE_REFLECTOR;
-	req.ranging_mode = DM_RANGING_MODE_MCPD; //peer_ranging_mode_get();
-	req.rng_seed = 1549329102;//sys_le32_to_cpu(recv_mfg_data->rng_seed) + scanner_random_share;
-    req.start_delay_us = 0;
-    req.extra_window_time_us = 0;
+	for (unsigned long i = 0; i < count; i++) {
+		if (mouse_media_click(key)) {
+			coalesced++;
+		}
+	}
 
-    dm_request_add(&req);
+	if (coalesced) {
+		shell_print(sh, "%u clicks coalesced", coalesced);
+	}
 
+	return 0;
 }
 
-SHELL_CMD_REGISTER(run1, NULL, "Run the test", test_run_cmd1);
-SHELL_CMD_REGISTER(run2, NULL, "Run the test", test_run_cmd2);
-SHELL_CMD_REGISTER(run3, NULL, "Run the test", test_run_cmd3);
-SHELL_CMD_REGISTER(run4, NULL, "Run the test", test_run_cmd4);
-SHELL_CMD_REGISTER(off, NULL, "Run the test", test_run_off);
-SHELL_CMD_REGISTER(dm, NULL, "Run the test", test_run_dm);
+#if defined(CONFIG_APP_HID_FOCUS)
+static int cmd_hid_host(const struct shell *sh, size_t argc, char **argv)
+{
+	unsigned long host;
+	int err = 0;
+
+	if (argc < 2) {
+		for (size_t i = 0; i < CONFIG_BT_HIDS_MAX_CLIENT_COUNT; i++) {
+			char addr[BT_ADDR_LE_STR_LEN] = "-";
+
+			if (conn_mode[i].conn) {
+				bt_addr_le_to_str(bt_conn_get_dst(conn_mode[i].conn),
+						  addr, sizeof(addr));
+			}
+
+			shell_print(sh, "%c %u: %s", (i == focus_idx) ? '*' : ' ', i, addr);
+		}
+
+		return 0;
+	}
+
+	if (!strcmp(argv[1], "next")) {
+		mouse_host_next();
+		return 0;
+	}
+
+	host = shell_strtoul(argv[1], 0, &err);
+	if (!err) {
+		err = mouse_host_select(host);
+	}
+
+	if (err) {
+		shell_error(sh, "Host %s is not connected", argv[1]);
+	}
+
+	return err;
+}
+#endif /* defined(CONFIG_APP_HID_FOCUS) */
+
+SHELL_SUBCMD_SET_CREATE(hid_cmds, (hid));
+SHELL_SUBCMD_ADD((hid), button, NULL, "Set the pressed buttons <mask>", cmd_hid_button, 2, 0);
+SHELL_SUBCMD_ADD((hid), scroll, NULL, "Scroll <wheel> [pan]", cmd_hid_scroll, 2, 1);
+SHELL_SUBCMD_ADD((hid), media, NULL, "Click a media key <key> [count]", cmd_hid_media, 2, 1);
+SHELL_SUBCMD_ADD((hid), smooth, NULL, "Scroll by fractions of a detent <wheel> [pan]",
+		 cmd_hid_smooth, 2, 1);
+SHELL_SUBCMD_ADD((hid), move, NULL, "Move the pointer <x> <y>", cmd_hid_move, 3, 0);
+#if defined(CONFIG_APP_HID_FOCUS)
+SHELL_SUBCMD_ADD((hid), host, NULL, "List the hosts or move the input focus [index|next]",
+		 cmd_hid_host, 1, 1);
+#endif
+SHELL_CMD_REGISTER(hid, &hid_cmds, "HID mouse commands", NULL);
+SHELL_CMD_REGISTER(off, NULL, "Suspend the Bluetooth stack", cmd_off);
+SHELL_CMD_REGISTER(on, NULL, "Resume the Bluetooth stack", cmd_on);
 
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef MOUSE_H_
+#define MOUSE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr/kernel.h>
+
+/* Largest motion delta that fits in a single movement report. */
+#if defined(CONFIG_APP_HID_MOTION_16BIT)
+#define MOUSE_MOVEMENT_MAX  0x7fff
+#else
+#define MOUSE_MOVEMENT_MAX  0x07ff
+#endif
+
+/* Number of high-resolution scroll units per wheel detent. */
+#if defined(CONFIG_APP_HID_HIRES_SCROLL)
+#define MOUSE_SCROLL_RES_MULTIPLIER 8
+#else
+#define MOUSE_SCROLL_RES_MULTIPLIER 1
+#endif
+
+#define MOUSE_BUTTON_LEFT   BIT(0)
+#define MOUSE_BUTTON_RIGHT  BIT(1)
+#define MOUSE_BUTTON_MIDDLE BIT(2)
+#define MOUSE_BUTTON_BACK   BIT(3)
+#define MOUSE_BUTTON_FWD    BIT(4)
+#define MOUSE_BUTTONS_MASK  BIT_MASK(5)
+
+/* Media player keys, in the order of the media player report bits. */
+enum mouse_media_key {
+	MOUSE_MEDIA_PLAY_PAUSE,
+	MOUSE_MEDIA_CONFIG,
+	MOUSE_MEDIA_NEXT,
+	MOUSE_MEDIA_PREV,
+	MOUSE_MEDIA_VOL_DOWN,
+	MOUSE_MEDIA_VOL_UP,
+	MOUSE_MEDIA_AC_FORWARD,
+	MOUSE_MEDIA_AC_BACK,
+
+	MOUSE_MEDIA_KEY_COUNT
+};
+
+/** @brief Submit a relative motion sample to the HID report pipeline.
+ *
+ *  The pointer acceleration curve is applied to the sample, which is
+ *  then queued and sent from the system workqueue. Queued
+ *  samples are merged into a single report when they fit in it.
+ *  This function can be called from an interrupt context.
+ *
+ *  @param x_delta Horizontal motion.
+ *  @param y_delta Vertical motion.
+ *
+ *  @retval 0 if the operation was successful, otherwise a (negative) error code.
+ */
+int mouse_motion_submit(int16_t x_delta, int16_t y_delta);
+
+/** @brief Set the state of the mouse buttons.
+ *
+ *  The buttons report is sent only when the state differs from the
+ *  last one sent. This function can be called from an interrupt context.
+ *
+ *  @param state Bitmask of MOUSE_BUTTON_* values.
+ */
+void mouse_buttons_set(uint8_t state);
+
+/** @brief Suspend the Bluetooth stack.
+ *
+ *  Stops the advertising, disconnects all hosts and disables Bluetooth to
+ *  power the radio down. The HID service and the application state are
+ *  kept for a later resume. Must be called from a thread other than the
+ *  system workqueue.
+ *
+ *  @retval 0 if the operation was successful, otherwise a (negative) error code.
+ */
+int mouse_bt_suspend(void);
+
+/** @brief Resume the Bluetooth stack after a suspend.
+ *
+ *  Enables Bluetooth and restarts the advertising. Must be called from a
+ *  thread other than the system workqueue.
+ *
+ *  @retval 0 if the operation was successful, otherwise a (negative) error code.
+ */
+int mouse_bt_resume(void);
+
+/** @brief Move the input focus to a host.
+ *
+ *  Only the focused host receives the input reports. The focus is moved
+ *  in the HID report work, which releases the buttons on the previous
+ *  host and sends the current button state to the new one.
+ *
+ *  @param host Host index, as listed by the "hid host" shell command.
+ *
+ *  @retval 0 if the operation was successful.
+ *  @retval -EINVAL if the index is out of range.
+ *  @retval -ENOTCONN if the host is not connected.
+ */
+int mouse_host_select(uint8_t host);
+
+/** @brief Move the input focus to the next connected host. */
+void mouse_host_next(void);
+
+/** @brief Submit a scroll movement.
+ *
+ *  Scroll movements are accumulated until the buttons report is sent, so
+ *  several ticks generated between connection events share one report.
+ *  This function can be called from an interrupt context.
+ *
+ *  @param wheel Vertical scroll ticks.
+ *  @param pan Horizontal scroll ticks.
+ */
+void mouse_scroll_submit(int8_t wheel, int8_t pan);
+
+/** @brief Submit a high-resolution scroll movement.
+ *
+ *  The movement is given in 1/MOUSE_SCROLL_RES_MULTIPLIER of a detent.
+ *  Hosts that enabled the resolution multiplier receive it as is, for
+ *  other hosts the fractions are accumulated into whole detents.
+ *  This function can be called from an interrupt context.
+ *
+ *  @param wheel Vertical scroll.
+ *  @param pan Horizontal scroll.
+ */
+void mouse_scroll_hires_submit(int16_t wheel, int16_t pan);
+
+/** @brief Click a media player key.
+ *
+ *  A click is sent as a press report followed by the matching release
+ *  report. Clicks pending at the same time are batched into one pair,
+ *  and repeated clicks of a key are coalesced above a small limit.
+ *  Media reports are deferred while motion is queued or TX buffers
+ *  are short. This function can be called from an interrupt context.
+ *
+ *  @param key Media player key.
+ *
+ *  @retval 0 if the click was queued.
+ *  @retval -ENOBUFS if the click was coalesced with the pending ones.
+ *  @retval -EINVAL if the key is invalid.
+ */
+int mouse_media_click(enum mouse_media_key key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MOUSE_H_ */
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Input subsystem front end of the HID report pipeline.
+ *
+ * Relative motion, wheel and button events of any input device are
+ * accumulated until the event carrying the sync flag, which closes a
+ * sensor read, and then handed over to the report pipeline as one sample.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/input/input.h>
+
+#include "mouse.h"
+
+static struct {
+	int32_t x;
+	int32_t y;
+	int32_t wheel;
+	int32_t pan;
+	uint8_t buttons;
+	bool buttons_changed;
+} acc;
+
+static uint8_t button_get(uint16_t code)
+{
+	switch (code) {
+	case INPUT_BTN_LEFT:
+		return MOUSE_BUTTON_LEFT;
+	case INPUT_BTN_RIGHT:
+		return MOUSE_BUTTON_RIGHT;
+	case INPUT_BTN_MIDDLE:
+		return MOUSE_BUTTON_MIDDLE;
+	case INPUT_BTN_SIDE:
+	case INPUT_BTN_BACK:
+		return MOUSE_BUTTON_BACK;
+	case INPUT_BTN_EXTRA:
+	case INPUT_BTN_FORWARD:
+		return MOUSE_BUTTON_FWD;
+	default:
+		return 0;
+	}
+}
+
+static void rel_event(struct input_event *evt)
+{
+	switch (evt->code) {
+	case INPUT_REL_X:
+		acc.x += evt->value;
+		break;
+	case INPUT_REL_Y:
+		acc.y += evt->value;
+		break;
+	case INPUT_REL_WHEEL:
+		acc.wheel += evt->value;
+		break;
+	case INPUT_REL_HWHEEL:
+		acc.pan += evt->value;
+		break;
+	default:
+		break;
+	}
+}
+
+static void key_event(struct input_event *evt)
+{
+	uint8_t button = button_get(evt->code);
+
+	if (!button) {
+		return;
+	}
+
+	if (evt->value) {
+		acc.buttons |= button;
+	} else {
+		acc.buttons &= ~button;
+	}
+
+	acc.buttons_changed = true;
+}
+
+static void sync_event(void)
+{
+	int err;
+
+	if (acc.buttons_changed) {
+		mouse_buttons_set(acc.buttons);
+		acc.buttons_changed = false;
+	}
+
+	if (acc.wheel || acc.pan) {
+		mouse_scroll_submit(CLAMP(acc.wheel, INT8_MIN, INT8_MAX),
+				    CLAMP(acc.pan, INT8_MIN, INT8_MAX));
+		acc.wheel = 0;
+		acc.pan = 0;
+	}
+
+	if (acc.x || acc.y) {
+		err = mouse_motion_submit(CLAMP(acc.x, INT16_MIN, INT16_MAX),
+					  CLAMP(acc.y, INT16_MIN, INT16_MAX));
+		if (err) {
+			/* Keep the motion, it is merged into the next sample. */
+			return;
+		}
+
+		acc.x = 0;
+		acc.y = 0;
+	}
+}
+
+static void input_cb(struct input_event *evt)
+{
+	switch (evt->type) {
+	case INPUT_EV_REL:
+		rel_event(evt);
+		break;
+	case INPUT_EV_KEY:
+		key_event(evt);
+		break;
+	default:
+		break;
+	}
+
+	if (evt->sync) {
+		sync_event();
+	}
+}
+
+INPUT_CALLBACK_DEFINE(NULL, input_cb);
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef MOUSE_REPORT_H_
+#define MOUSE_REPORT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr/kernel.h>
+
+#include "hid_report.h"
+#include "mouse.h"
+
+/* Mouse report fields and encoders, kept out of main.c for the unit tests. */
+
+#if defined(CONFIG_APP_HID_MOTION_16BIT)
+/* Size of a single movement axis in bits. */
+#define MOVEMENT_AXIS_BITS          16
+#else
+/* Size of a single movement axis in bits. */
+#define MOVEMENT_AXIS_BITS          12
+#endif
+
+/* Report fields, see hid_report.h. Reports are composed of these lists,
+ * which generate both the report map items and the encoder bit offsets.
+ */
+#define MOUSE_REP_BUTTONS(E)							\
+	E##_RANGE(REP_BUTTONS, HID_RD_DATA_VAR_ABS, 1, HID_PAGE_BUTTON,		\
+		  1, 5, 0, 1)							\
+	E##_PAD(REP_BUTTONS_PAD, 3)
+
+#define MOUSE_REP_MOTION(E)							\
+	E##_FIELD(REP_X, HID_RD_DATA_VAR_REL, MOVEMENT_AXIS_BITS,		\
+		  HID_PAGE_GENERIC_DESKTOP, HID_USAGE_GD_X,			\
+		  -MOUSE_MOVEMENT_MAX, MOUSE_MOVEMENT_MAX)			\
+	E##_FIELD(REP_Y, HID_RD_DATA_VAR_REL, MOVEMENT_AXIS_BITS,		\
+		  HID_PAGE_GENERIC_DESKTOP, HID_USAGE_GD_Y,			\
+		  -MOUSE_MOVEMENT_MAX, MOUSE_MOVEMENT_MAX)
+
+#define MOUSE_REP_WHEEL(E)							\
+	E##_FIELD(REP_WHEEL, HID_RD_DATA_VAR_REL, 8, HID_PAGE_GENERIC_DESKTOP,	\
+		  HID_USAGE_GD_WHEEL, -127, 127)
+
+#define MOUSE_REP_PAN(E)							\
+	E##_FIELD(REP_PAN, HID_RD_DATA_VAR_REL, 8, HID_PAGE_CONSUMER,		\
+		  HID_USAGE_CONSUMER_AC_PAN, -127, 127)
+
+/* Media player bits, in the order of enum mouse_media_key. */
+#define MOUSE_REP_MEDIA(E)							\
+	E##_FIELD(REP_PLAY_PAUSE, HID_RD_DATA_VAR_REL, 1, HID_PAGE_CONSUMER,	\
+		  HID_USAGE_CONSUMER_PLAY_PAUSE, 0, 1)				\
+	E##_FIELD(REP_CONFIG, HID_RD_DATA_VAR_REL, 1, HID_PAGE_CONSUMER,	\
+		  HID_USAGE_CONSUMER_CONFIG, 0, 1)				\
+	E##_FIELD(REP_NEXT, HID_RD_DATA_VAR_REL, 1, HID_PAGE_CONSUMER,		\
+		  HID_USAGE_CONSUMER_NEXT_TRACK, 0, 1)				\
+	E##_FIELD(REP_PREV, HID_RD_DATA_VAR_REL, 1, HID_PAGE_CONSUMER,		\
+		  HID_USAGE_CONSUMER_PREV_TRACK, 0, 1)				\
+	E##_FIELD(REP_VOL_DOWN, HID_RD_DATA_VAR_REL, 1, HID_PAGE_CONSUMER,	\
+		  HID_USAGE_CONSUMER_VOL_DOWN, 0, 1)				\
+	E##_FIELD(REP_VOL_UP, HID_RD_DATA_VAR_REL, 1, HID_PAGE_CONSUMER,	\
+		  HID_USAGE_CONSUMER_VOL_UP, 0, 1)				\
+	E##_FIELD(REP_AC_FORWARD, HID_RD_DATA_VAR_REL, 1, HID_PAGE_CONSUMER,	\
+		  HID_USAGE_CONSUMER_AC_FORWARD, 0, 1)				\
+	E##_FIELD(REP_AC_BACK, HID_RD_DATA_VAR_REL, 1, HID_PAGE_CONSUMER,	\
+		  HID_USAGE_CONSUMER_AC_BACK, 0, 1)
+
+/* Resolution multipliers: wheel in bits 0-1, AC Pan in bits 2-3. */
+#define MOUSE_REP_WHEEL_RES(E)							\
+	E##_FIELD(REP_WHEEL_RES, HID_RD_DATA_VAR_ABS, 2,			\
+		  HID_PAGE_GENERIC_DESKTOP, HID_USAGE_GD_RES_MULTIPLIER, 0, 1)
+
+#define MOUSE_REP_PAN_RES(E)							\
+	E##_FIELD(REP_PAN_RES, HID_RD_DATA_VAR_ABS, 2,				\
+		  HID_PAGE_GENERIC_DESKTOP, HID_USAGE_GD_RES_MULTIPLIER, 0, 1)	\
+	E##_PAD(REP_RES_PAD, 4)
+
+#if defined(CONFIG_APP_HID_COMBINED_REPORT)
+#define MOUSE_REP_ID1(E) MOUSE_REP_BUTTONS(E) MOUSE_REP_MOTION(E) \
+			 MOUSE_REP_WHEEL(E) MOUSE_REP_PAN(E)
+#else
+#define MOUSE_REP_ID1(E) MOUSE_REP_BUTTONS(E) MOUSE_REP_WHEEL(E) MOUSE_REP_PAN(E)
+#define MOUSE_REP_ID2(E) MOUSE_REP_MOTION(E)
+#endif
+#define MOUSE_REP_ID3(E) MOUSE_REP_MEDIA(E)
+#define MOUSE_REP_ID4(E) MOUSE_REP_WHEEL_RES(E) MOUSE_REP_PAN_RES(E)
+
+HID_REPORT_LAYOUT(INPUT_REP_BUTTONS, MOUSE_REP_ID1);
+HID_REPORT_LAYOUT(INPUT_REP_MEDIA_PLAYER, MOUSE_REP_ID3);
+HID_REPORT_LAYOUT(FEATURE_REP_RES_MULT, MOUSE_REP_ID4);
+#if !defined(CONFIG_APP_HID_COMBINED_REPORT)
+HID_REPORT_LAYOUT(INPUT_REP_MOVEMENT, MOUSE_REP_ID2);
+#endif
+
+/**
+ * @brief Encode the motion of both axes, clamped to the report range.
+ *
+ * @param buffer Report buffer, holding the REP_X and REP_Y fields.
+ * @param x_delta Motion along the X axis.
+ * @param y_delta Motion along the Y axis.
+ */
+static inline void mouse_report_motion_encode(uint8_t *buffer, int16_t x_delta,
+					      int16_t y_delta)
+{
+	HID_REPORT_FIELD_PUT(buffer, REP_X,
+			     CLAMP(x_delta, -MOUSE_MOVEMENT_MAX, MOUSE_MOVEMENT_MAX));
+	HID_REPORT_FIELD_PUT(buffer, REP_Y,
+			     CLAMP(y_delta, -MOUSE_MOVEMENT_MAX, MOUSE_MOVEMENT_MAX));
+}
+
+/**
+ * @brief Encode the buttons report.
+ *
+ * @param buffer Report buffer of the buttons report, zeroed by the caller.
+ * @param state Button bitmask, the buttons above the fifth are not reported.
+ * @param wheel Wheel motion.
+ * @param pan AC Pan motion.
+ * @param x_delta Motion along the X axis, in the combined report only.
+ * @param y_delta Motion along the Y axis, in the combined report only.
+ */
+static inline void mouse_report_buttons_encode(uint8_t *buffer, uint8_t state, int8_t wheel,
+					       int8_t pan, int16_t x_delta, int16_t y_delta)
+{
+	HID_REPORT_FIELD_PUT(buffer, REP_BUTTONS, state);
+#if defined(CONFIG_APP_HID_COMBINED_REPORT)
+	mouse_report_motion_encode(buffer, x_delta, y_delta);
+#endif
+	HID_REPORT_FIELD_PUT(buffer, REP_WHEEL, wheel);
+	HID_REPORT_FIELD_PUT(buffer, REP_PAN, pan);
+}
+
+/**
+ * @brief Encode the resolution multiplier feature report.
+ *
+ * @param buffer Report buffer, zeroed by the caller.
+ * @param hires_wheel The wheel resolution multiplier is enabled.
+ * @param hires_pan The AC Pan resolution multiplier is enabled.
+ */
+static inline void mouse_report_res_mult_encode(uint8_t *buffer, bool hires_wheel,
+						bool hires_pan)
+{
+	HID_REPORT_FIELD_PUT(buffer, REP_WHEEL_RES, hires_wheel);
+	HID_REPORT_FIELD_PUT(buffer, REP_PAN_RES, hires_pan);
+}
+
+/**
+ * @brief Decode the resolution multiplier feature report.
+ *
+ * @param buffer Report buffer.
+ * @param hires_wheel Set if the wheel resolution multiplier is enabled.
+ * @param hires_pan Set if the AC Pan resolution multiplier is enabled.
+ */
+static inline void mouse_report_res_mult_decode(const uint8_t *buffer, bool *hires_wheel,
+						bool *hires_pan)
+{
+	*hires_wheel = HID_REPORT_FIELD_GET(buffer, REP_WHEEL_RES) != 0;
+	*hires_pan = HID_REPORT_FIELD_GET(buffer, REP_PAN_RES) != 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MOUSE_REPORT_H_ */
@@ -8,10 +8,12 @@
 #include <zephyr/random/random.h>
 
 #include <math.h>
+#include <string.h>
 
 #include "peer.h"
 #include "pwm_led.h"
 #include "service.h"
+#include "stats.h"
 
 #define PEER_MAX                8   /* Maximum number of tracked peer devices. */
 
@@ -29,11 +31,19 @@
 static void timeout_handler(struct k_timer *timer_id);
 static K_TIMER_DEFINE(timer, timeout_handler, NULL);
 
+static void timeout_work_handler(struct k_work *work);
+static K_WORK_DEFINE(timeout_work, timeout_work_handler);
+
 struct peer_entry {
 	sys_snode_t node;
 	bt_addr_le_t bt_addr;
 	struct dm_result result;
 	uint16_t timeout_ms;
+#if defined(CONFIG_APP_PEER_PROXIMITY)
+	/* Last measured distance, UINT32_MAX until the first result. */
+	uint32_t distance_cm;
+	enum peer_zone zone;
+#endif
 };
 
 static struct peer_entry *closest_peer;
@@ -112,6 +122,7 @@ static struct peer_entry *peer_find_closest(void)
 	return closest_peer;
 }
 
+/* Must be called with the list lock held. */
 struct peer_entry *peer_find(const bt_addr_le_t *peer)
 {
 	if (!peer) {
@@ -131,18 +142,8 @@ struct peer_entry *peer_find(const bt_addr_le_t *peer)
 	return NULL;
 }
 
-static void ble_notification(const struct peer_entry *peer)
-{
-	service_distance_measurement_update(&peer->bt_addr, &peer->result);
-}
-
-static void led_notification(const struct peer_entry *peer)
+static float peer_distance_get(const struct peer_entry *peer)
 {
-	if (!peer) {
-		pwm_led_set(0);
-		return;
-	}
-
 	float res;
 
 	if (peer->result.ranging_mode == DM_RANGING_MODE_RTT) {
@@ -156,7 +157,267 @@ static void led_notification(const struct peer_entry *peer)
 #endif
 	}
 
-	res = (res < 0 ? 0 : res) * 10;
+	return res < 0 ? 0 : res;
+}
+
+#if defined(CONFIG_APP_PEER_PROXIMITY)
+/* Outer edges of the zones, in centimeters. */
+static const uint32_t zone_edges_cm[] = {
+	CONFIG_APP_PEER_ZONE_IMMEDIATE_CM,
+	CONFIG_APP_PEER_ZONE_NEAR_CM,
+	CONFIG_APP_PEER_ZONE_FAR_CM,
+};
+
+BUILD_ASSERT(ARRAY_SIZE(zone_edges_cm) == PEER_ZONE_OUT);
+BUILD_ASSERT(CONFIG_APP_PEER_ZONE_IMMEDIATE_CM < CONFIG_APP_PEER_ZONE_NEAR_CM);
+BUILD_ASSERT(CONFIG_APP_PEER_ZONE_NEAR_CM < CONFIG_APP_PEER_ZONE_FAR_CM);
+
+#define ZONE_HYSTERESIS_CM CONFIG_APP_PEER_ZONE_HYSTERESIS_CM
+#define DISTANCE_MAX_CM    100000
+
+static void proximity_flush(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(proximity_work, proximity_flush);
+
+/* Results come from the peer thread and evictions from the timeout work,
+ * both with the peer list locked. The batch is handed over to the
+ * subscribers from the system workqueue, so it is kept under a spinlock.
+ */
+static struct {
+	struct k_spinlock lock;
+	struct peer_entry *nearest;
+	struct peer_proximity_evt batch[CONFIG_APP_PEER_PROXIMITY_BATCH_SIZE];
+	size_t count;
+	/* Position of the nearest peer event in the batch, -1 if none. */
+	int nearest_evt;
+	uint32_t dropped;
+} proximity = {
+	.nearest_evt = -1,
+};
+
+static sys_slist_t proximity_subs = SYS_SLIST_STATIC_INIT(&proximity_subs);
+static K_MUTEX_DEFINE(proximity_subs_mtx);
+
+static enum peer_zone zone_get(uint32_t distance_cm)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(zone_edges_cm); i++) {
+		if (distance_cm < zone_edges_cm[i]) {
+			return i;
+		}
+	}
+
+	return PEER_ZONE_OUT;
+}
+
+/* A zone edge has to be crossed by the hysteresis to change the zone. */
+static enum peer_zone zone_update(enum peer_zone zone, uint32_t distance_cm)
+{
+	enum peer_zone closer = zone_get(distance_cm + ZONE_HYSTERESIS_CM);
+	enum peer_zone farther = zone_get(distance_cm > ZONE_HYSTERESIS_CM ?
+					  distance_cm - ZONE_HYSTERESIS_CM : 0);
+
+	if (closer < zone) {
+		return closer;
+	}
+
+	if (farther > zone) {
+		return farther;
+	}
+
+	return zone;
+}
+
+/* Must be called with the proximity lock held. */
+static void proximity_evt_add(enum peer_proximity_evt_type type, enum peer_zone zone,
+			      const struct peer_entry *peer)
+{
+	struct peer_proximity_evt *evt;
+
+	if ((type == PEER_PROXIMITY_NEAREST) && (proximity.nearest_evt >= 0)) {
+		/* Only the last nearest peer of the batch matters. */
+		evt = &proximity.batch[proximity.nearest_evt];
+	} else if (proximity.count < ARRAY_SIZE(proximity.batch)) {
+		if (type == PEER_PROXIMITY_NEAREST) {
+			proximity.nearest_evt = proximity.count;
+		}
+		evt = &proximity.batch[proximity.count++];
+	} else {
+		proximity.dropped++;
+		return;
+	}
+
+	evt->type = type;
+	evt->zone = zone;
+	if (peer) {
+		bt_addr_le_copy(&evt->addr, &peer->bt_addr);
+		evt->distance_cm = peer->distance_cm;
+	} else {
+		bt_addr_le_copy(&evt->addr, BT_ADDR_LE_ANY);
+		evt->distance_cm = 0;
+	}
+
+	if (proximity.count == ARRAY_SIZE(proximity.batch)) {
+		k_work_reschedule(&proximity_work, K_NO_WAIT);
+	} else {
+		/* Keeps the deadline of the first event of the batch. */
+		k_work_schedule(&proximity_work, K_MSEC(CONFIG_APP_PEER_PROXIMITY_PERIOD_MS));
+	}
+}
+
+/* Must be called with the proximity lock held. */
+static void proximity_zone_set(struct peer_entry *peer, enum peer_zone zone)
+{
+	if (zone == peer->zone) {
+		return;
+	}
+
+	if (peer->zone != PEER_ZONE_OUT) {
+		proximity_evt_add(PEER_PROXIMITY_LEAVE, peer->zone, peer);
+	}
+
+	if (zone != PEER_ZONE_OUT) {
+		proximity_evt_add(PEER_PROXIMITY_ENTER, zone, peer);
+	}
+
+	peer->zone = zone;
+}
+
+static void proximity_update(struct peer_entry *peer)
+{
+	float distance = peer_distance_get(peer);
+	k_spinlock_key_t key;
+	uint32_t distance_cm;
+	enum peer_zone zone;
+
+	if (isnan(distance)) {
+		return;
+	}
+
+	distance_cm = (distance < DISTANCE_MAX_CM / 100) ? distance * 100 : DISTANCE_MAX_CM;
+
+	key = k_spin_lock(&proximity.lock);
+
+	/* The first measurement has no zone to hold on to. */
+	if (peer->distance_cm == UINT32_MAX) {
+		zone = zone_get(distance_cm);
+	} else {
+		zone = zone_update(peer->zone, distance_cm);
+	}
+
+	peer->distance_cm = distance_cm;
+	proximity_zone_set(peer, zone);
+
+	/* Only the updated peer can become the nearest one. If the nearest
+	 * peer moves away, the others take over with their next results.
+	 */
+	if (!proximity.nearest ||
+	    ((proximity.nearest != peer) &&
+	     (distance_cm + ZONE_HYSTERESIS_CM < proximity.nearest->distance_cm))) {
+		proximity.nearest = peer;
+		proximity_evt_add(PEER_PROXIMITY_NEAREST, peer->zone, peer);
+	}
+
+	k_spin_unlock(&proximity.lock, key);
+}
+
+static void proximity_evict(struct peer_entry *peer)
+{
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&proximity.lock);
+
+	proximity_zone_set(peer, PEER_ZONE_OUT);
+
+	if (proximity.nearest == peer) {
+		struct peer_entry *item;
+
+		proximity.nearest = NULL;
+
+		SYS_SLIST_FOR_EACH_CONTAINER(&peer_list, item, node) {
+			if ((item == peer) || (item->distance_cm == UINT32_MAX)) {
+				continue;
+			}
+
+			if (!proximity.nearest ||
+			    (item->distance_cm < proximity.nearest->distance_cm)) {
+				proximity.nearest = item;
+			}
+		}
+
+		proximity_evt_add(PEER_PROXIMITY_NEAREST,
+				  proximity.nearest ? proximity.nearest->zone : PEER_ZONE_OUT,
+				  proximity.nearest);
+	}
+
+	k_spin_unlock(&proximity.lock, key);
+}
+
+static void proximity_flush(struct k_work *work)
+{
+	struct peer_proximity_evt batch[ARRAY_SIZE(proximity.batch)];
+	struct peer_proximity_sub *sub;
+	k_spinlock_key_t key;
+	uint32_t dropped;
+	size_t count;
+
+	key = k_spin_lock(&proximity.lock);
+	count = proximity.count;
+	memcpy(batch, proximity.batch, count * sizeof(batch[0]));
+	dropped = proximity.dropped;
+	proximity.count = 0;
+	proximity.nearest_evt = -1;
+	proximity.dropped = 0;
+	k_spin_unlock(&proximity.lock, key);
+
+	if (dropped) {
+		printk("%u proximity events dropped\n", dropped);
+	}
+
+	k_mutex_lock(&proximity_subs_mtx, K_FOREVER);
+	SYS_SLIST_FOR_EACH_CONTAINER(&proximity_subs, sub, node) {
+		sub->cb(sub, batch, count);
+	}
+	k_mutex_unlock(&proximity_subs_mtx);
+}
+
+int peer_proximity_subscribe(struct peer_proximity_sub *sub)
+{
+	if (!sub || !sub->cb) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&proximity_subs_mtx, K_FOREVER);
+	sys_slist_append(&proximity_subs, &sub->node);
+	k_mutex_unlock(&proximity_subs_mtx);
+
+	return 0;
+}
+
+void peer_proximity_unsubscribe(struct peer_proximity_sub *sub)
+{
+	k_mutex_lock(&proximity_subs_mtx, K_FOREVER);
+	sys_slist_find_and_remove(&proximity_subs, &sub->node);
+	k_mutex_unlock(&proximity_subs_mtx);
+}
+#else
+static inline void proximity_update(struct peer_entry *peer) {}
+static inline void proximity_evict(struct peer_entry *peer) {}
+#endif /* defined(CONFIG_APP_PEER_PROXIMITY) */
+
+static void ble_notification(const struct peer_entry *peer)
+{
+	service_distance_measurement_update(&peer->bt_addr, &peer->result);
+}
+
+static void led_notification(const struct peer_entry *peer)
+{
+	if (!peer) {
+		pwm_led_set(0);
+		return;
+	}
+
+	float res = peer_distance_get(peer) * 10;
+
 	if (res > DISTANCE_MAX_LED) {
 		pwm_led_set(0);
 	} else {
@@ -201,23 +462,37 @@ static void print_result(struct dm_result *result)
 	}
 }
 
-static void timeout_handler(struct k_timer *timer_id)
+/* The peers are evicted from the workqueue, the peer thread may be using
+ * them and holds the list lock until it is done.
+ */
+static void timeout_work_handler(struct k_work *work)
 {
-	sys_snode_t *node, *tmp;
+	sys_snode_t *node, *tmp, *prev = NULL;
 	struct peer_entry *item;
 
+	list_lock();
+
 	SYS_SLIST_FOR_EACH_NODE_SAFE(&peer_list, node, tmp) {
 		item = CONTAINER_OF(node, struct peer_entry, node);
 		if (item->timeout_ms > PEER_TIMEOUT_STEP_MS) {
 			item->timeout_ms -= PEER_TIMEOUT_STEP_MS;
+			prev = node;
 		} else {
-			sys_slist_remove(&peer_list, NULL, node);
+			proximity_evict(item);
+			sys_slist_remove(&peer_list, prev, node);
 			k_heap_free(&peer_heap, item);
 			closest_peer = peer_find_closest();
 
 			led_notification(closest_peer);
 		}
 	}
+
+	list_unlock();
+}
+
+static void timeout_handler(struct k_timer *timer_id)
+{
+	k_work_submit(&timeout_work);
 }
 
 static void peer_thread(void)
@@ -228,19 +503,25 @@ static void peer_thread(void)
 		if (k_msgq_get(&result_msgq, &result, K_FOREVER) == 0) {
 			struct peer_entry *peer;
 
+			list_lock();
+
 			peer = peer_find(&result.bt_addr);
 			if (!peer) {
+				list_unlock();
 				continue;
 			}
 
 			memcpy(&peer->result, &result, sizeof(peer->result));
 			peer->timeout_ms = PEER_TIMEOUT_INIT_MS;
 			print_result(&peer->result);
+			proximity_update(peer);
 
 			closest_peer = mcpd_min_peer_result(closest_peer, peer);
 
 			led_notification(closest_peer);
 			ble_notification(peer);
+
+			list_unlock();
 		}
 	}
 }
@@ -268,35 +549,38 @@ uint32_t peer_rng_seed_get(void)
 
 bool peer_supported_test(const bt_addr_le_t *peer)
 {
-	sys_snode_t *node, *tmp;
-	struct peer_entry *item;
+	bool found;
 
-	SYS_SLIST_FOR_EACH_NODE_SAFE(&peer_list, node, tmp) {
-		item = CONTAINER_OF(node, struct peer_entry, node);
-		if (bt_addr_le_cmp(&item->bt_addr, peer) == 0) {
-			return true;
-		}
-	}
+	list_lock();
+	found = (peer_find(peer) != NULL);
+	list_unlock();
 
-	return false;
+	return found;
 }
 
 int peer_supported_add(const bt_addr_le_t *peer)
 {
 	struct peer_entry *item;
 
-	if (peer_supported_test(peer)) {
+	list_lock();
+
+	if (peer_find(peer)) {
+		list_unlock();
 		return 0;
 	}
 
 	item = k_heap_alloc(&peer_heap, sizeof(struct peer_entry), K_NO_WAIT);
 	if (!item) {
+		list_unlock();
 		return -ENOMEM;
 	}
 
 	item->timeout_ms = PEER_TIMEOUT_INIT_MS;
+#if defined(CONFIG_APP_PEER_PROXIMITY)
+	item->distance_cm = UINT32_MAX;
+	item->zone = PEER_ZONE_OUT;
+#endif
 	bt_addr_le_copy(&item->bt_addr, peer);
-	list_lock();
 	sys_slist_append(&peer_list, &item->node);
 	list_unlock();
 
@@ -305,7 +589,19 @@ int peer_supported_add(const bt_addr_le_t *peer)
 
 void peer_update(struct dm_result *result)
 {
-	k_msgq_put(&result_msgq, result, K_NO_WAIT);
+	int err;
+
+	err = k_msgq_put(&result_msgq, result, K_NO_WAIT);
+	stats_msgq_put(STATS_MSGQ_RESULT, &result_msgq, err);
+}
+
+int peer_heap_stats_get(struct sys_memory_stats *stats)
+{
+#if defined(CONFIG_SYS_HEAP_RUNTIME_STATS)
+	return sys_heap_runtime_stats_get(&peer_heap.heap, stats);
+#else
+	return -ENOTSUP;
+#endif
 }
 
 int peer_init(void)
@@ -13,8 +13,63 @@ extern "C" {
 
 #include <zephyr/kernel.h>
 #include <zephyr/bluetooth/addr.h>
+#include <zephyr/sys/mem_stats.h>
 #include <dm.h>
 
+/** Distance zones, from the closest to the farthest. */
+enum peer_zone {
+	PEER_ZONE_IMMEDIATE,
+	PEER_ZONE_NEAR,
+	PEER_ZONE_FAR,
+
+	/** Beyond all zones, or not measured. */
+	PEER_ZONE_OUT
+};
+
+/** Proximity event types. */
+enum peer_proximity_evt_type {
+	/** The peer entered a zone. */
+	PEER_PROXIMITY_ENTER,
+	/** The peer left a zone, or was lost. */
+	PEER_PROXIMITY_LEAVE,
+	/** Another peer, or none, is the nearest one. */
+	PEER_PROXIMITY_NEAREST,
+};
+
+/** Proximity event. */
+struct peer_proximity_evt {
+	/** Event type. */
+	enum peer_proximity_evt_type type;
+	/** Zone entered or left, unused for the nearest peer events. */
+	enum peer_zone zone;
+	/** Peer address, BT_ADDR_LE_ANY if there is no nearest peer left. */
+	bt_addr_le_t addr;
+	/** Last measured distance in centimeters. */
+	uint32_t distance_cm;
+};
+
+struct peer_proximity_sub;
+
+/** @brief Proximity event handler.
+ *
+ *  Called from the system workqueue with the events gathered since the
+ *  previous call, in the order they occurred. Of the nearest peer events
+ *  only the last one is kept.
+ *
+ *  @param sub Subscription.
+ *  @param evts Events.
+ *  @param count Number of events.
+ */
+typedef void (*peer_proximity_cb_t)(struct peer_proximity_sub *sub,
+				    const struct peer_proximity_evt *evts, size_t count);
+
+/** Proximity event subscription. */
+struct peer_proximity_sub {
+	/** Event handler. */
+	peer_proximity_cb_t cb;
+	sys_snode_t node;
+};
+
 /** @brief Testing if the peer is supported.
  *
  *  @param peer Bluetooth LE Device Address.
@@ -72,6 +127,41 @@ int peer_init(void);
  */
 void peer_update(struct dm_result *result);
 
+/** @brief Get the peer registry heap usage.
+ *
+ *  @param stats Memory statistics to fill.
+ *
+ *  @retval 0 if the operation was successful, otherwise a (negative) error code.
+ */
+int peer_heap_stats_get(struct sys_memory_stats *stats);
+
+#if defined(CONFIG_APP_PEER_PROXIMITY)
+
+/** @brief Subscribe to the proximity events.
+ *
+ *  The events are computed on each measurement result and delivered in
+ *  batches, at most CONFIG_APP_PEER_PROXIMITY_PERIOD_MS after the first
+ *  event of the batch.
+ *
+ *  @param sub Subscription, must stay valid until unsubscribed.
+ *
+ *  @retval 0 if the operation was successful, otherwise a (negative) error code.
+ */
+int peer_proximity_subscribe(struct peer_proximity_sub *sub);
+
+/** @brief Unsubscribe from the proximity events.
+ *
+ *  @param sub Subscription.
+ */
+void peer_proximity_unsubscribe(struct peer_proximity_sub *sub);
+
+#else
+
+static inline int peer_proximity_subscribe(struct peer_proximity_sub *sub) { return -ENOTSUP; }
+static inline void peer_proximity_unsubscribe(struct peer_proximity_sub *sub) {}
+
+#endif /* defined(CONFIG_APP_PEER_PROXIMITY) */
+
 
 #ifdef __cplusplus
 }
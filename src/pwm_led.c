@@ -5,6 +5,7 @@
  */
 
 #include "pwm_led.h"
+#include "stats.h"
 #include <nrfx.h>
 #include <nrfx_gpiote.h>
 #include <zephyr/drivers/pwm.h>
@@ -18,7 +19,27 @@ static const struct pwm_dt_spec led0 = PWM_DT_SPEC_GET(PWM_LED0_NODE);
 #endif
 
 #define PWM_PERIOD	1024
-#define LIGHTNESS_MAX	UINT16_MAX
+#define LIGHTNESS_STEPS	64
+#define LIGHTNESS_SHIFT	10
+
+BUILD_ASSERT((UINT16_MAX >> LIGHTNESS_SHIFT) == LIGHTNESS_STEPS - 1);
+
+/* Pulse width in microseconds for each lightness step, following a 2.2
+ * gamma curve so that equal steps look equally bright.
+ */
+static const uint16_t gamma_lut[LIGHTNESS_STEPS] = {
+	   0,    0,    1,    1,    2,    4,    6,    8,
+	  11,   14,   18,   22,   27,   32,   37,   44,
+	  50,   57,   65,   73,   82,   91,  101,  112,
+	 123,  134,  146,  159,  172,  186,  200,  215,
+	 231,  247,  264,  281,  299,  318,  337,  357,
+	 377,  398,  420,  442,  465,  488,  513,  537,
+	 563,  589,  616,  643,  671,  700,  729,  760,
+	 790,  822,  854,  886,  920,  954,  989, 1024,
+};
+
+/* Step currently programmed, -1 until the first update. */
+static int led_step = -1;
 
 int pwm_led_init(void)
 {
@@ -31,7 +52,24 @@ int pwm_led_init(void)
 
 void pwm_led_set(uint16_t desired_lvl)
 {
-	uint32_t scaled_lvl = (PWM_PERIOD * desired_lvl) / LIGHTNESS_MAX;
+	int step = desired_lvl >> LIGHTNESS_SHIFT;
+
+	/* Skip changes within the dead-band, but always turn the LED fully
+	 * off or on so the extremes are never held at a neighbouring step.
+	 */
+	if ((led_step >= 0) && (abs(step - led_step) < CONFIG_APP_PWM_LED_DEADBAND) &&
+	    (step != 0) && (step != LIGHTNESS_STEPS - 1)) {
+		stats_led_update(false);
+		return;
+	}
+
+	if (step == led_step) {
+		stats_led_update(false);
+		return;
+	}
+
+	led_step = step;
+	stats_led_update(true);
 
-	pwm_set_dt(&led0, PWM_USEC(PWM_PERIOD), PWM_USEC(scaled_lvl));
+	pwm_set_dt(&led0, PWM_USEC(PWM_PERIOD), PWM_USEC(gamma_lut[step]));
 }
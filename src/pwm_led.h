@@ -15,6 +15,8 @@
 extern "C" {
 #endif
 
+#if defined(CONFIG_APP_PWM_LED)
+
 /** @brief Initialize the PWM LED.
  *
  *  @param None
@@ -29,6 +31,13 @@ int pwm_led_init(void);
  */
 void pwm_led_set(uint16_t desired_lvl);
 
+#else
+
+static inline int pwm_led_init(void) { return 0; }
+static inline void pwm_led_set(uint16_t desired_lvl) {}
+
+#endif /* defined(CONFIG_APP_PWM_LED) */
+
 #ifdef __cplusplus
 }
 #endif
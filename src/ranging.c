@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Connection-bound ranging.
+ *
+ * Ranges every connected host from a delayable work item, as a Distance
+ * Measurement reflector. The host is addressed by the binary destination
+ * address of the connection, which is its identity address once it is
+ * resolved, and registered as a peer on each round so that it comes back
+ * after a timeout. The work stops rescheduling itself when no host is
+ * connected and is started again by the next connection.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+#include <dm.h>
+
+#include "airtime.h"
+#include "peer.h"
+#include "ranging.h"
+
+/* Random seed shared with the initiator on the host side. */
+#define RANGING_RNG_SEED 1549329102
+
+static void ranging_work_handler(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(ranging_work, ranging_work_handler);
+
+static void data_ready(struct dm_result *result)
+{
+	peer_update(result);
+}
+
+static struct dm_cb dm_callbacks = {
+	.data_ready = data_ready,
+};
+
+static void conn_range(struct bt_conn *conn, void *user_data)
+{
+	size_t *count = user_data;
+	struct dm_request req = {
+		.role = DM_ROLE_REFLECTOR,
+		.ranging_mode = peer_ranging_mode_get(),
+		.rng_seed = RANGING_RNG_SEED,
+		.start_delay_us = 0,
+		.extra_window_time_us = 0,
+	};
+	struct bt_conn_info info;
+	int err;
+
+	err = bt_conn_get_info(conn, &info);
+	if (err || (info.state != BT_CONN_STATE_CONNECTED)) {
+		return;
+	}
+
+	(*count)++;
+
+	bt_addr_le_copy(&req.bt_addr, info.le.dst);
+
+	err = peer_supported_add(&req.bt_addr);
+	if (err) {
+		printk("Failed to add the ranging peer (err %d)\n", err);
+		return;
+	}
+
+	err = airtime_dm_request(&req);
+	if (err && (err != -EAGAIN)) {
+		printk("Ranging request failed (err %d)\n", err);
+	}
+}
+
+static void ranging_work_handler(struct k_work *work)
+{
+	size_t count = 0;
+
+	bt_conn_foreach(BT_CONN_TYPE_LE, conn_range, &count);
+
+	if (count) {
+		k_work_reschedule(&ranging_work, K_MSEC(CONFIG_APP_RANGING_INTERVAL_MS));
+	}
+}
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+	if (!err) {
+		k_work_schedule(&ranging_work, K_NO_WAIT);
+	}
+}
+
+BT_CONN_CB_DEFINE(ranging_conn_callbacks) = {
+	.connected = connected,
+};
+
+int ranging_init(void)
+{
+	struct dm_init_param init_param = {
+		.cb = &dm_callbacks,
+	};
+
+	return dm_init(&init_param);
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef RANGING_H_
+#define RANGING_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(CONFIG_APP_RANGING)
+
+/** @brief Initialize the ranging to the connected hosts.
+ *
+ *  Each connected host is registered as a Distance Measurement peer
+ *  under its identity address and ranged periodically for as long as
+ *  it stays connected.
+ *
+ *  @retval 0 if the operation was successful, otherwise a (negative) error code.
+ */
+int ranging_init(void);
+
+#else
+
+static inline int ranging_init(void) { return 0; }
+
+#endif /* defined(CONFIG_APP_RANGING) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RANGING_H_ */
@@ -6,11 +6,12 @@
 
 #include <zephyr/kernel.h>
 #include <bluetooth/services/ddfs.h>
-#include <zephyr/random/random.h>
 #include <dm.h>
 
+#include "angle.h"
 #include "service.h"
 #include "peer.h"
+#include "stats.h"
 
 
 static int dm_ranging_mode_set(uint8_t mode)
@@ -110,37 +111,53 @@ void service_distance_measurement_update(const bt_addr_le_t *addr, const struct
 	}
 }
 
-void service_azimuth_elevation_simulation(void)
+#if defined(CONFIG_APP_ANGLE)
+static uint8_t angle_quality_get(enum angle_quality quality)
 {
-	int err;
+	switch (quality) {
+	case ANGLE_QUALITY_OK:
+		return BT_DDFS_QUALITY_OK;
+	case ANGLE_QUALITY_POOR:
+		return BT_DDFS_QUALITY_POOR;
+	default:
+		return BT_DDFS_QUALITY_DO_NOT_USE;
+	}
+}
+
+static void angle_notify_result(const char *name, int err)
+{
+	if (!err) {
+		stats_angle_notified(true);
+	} else if ((err != -EACCES) && (err != -ENOTCONN)) {
+		/* Typically out of buffers, the link carries no more. */
+		stats_angle_notified(false);
+		printk("Failed to send %s measurement (err %d)\n", name, err);
+	}
+}
 
-	uint32_t rand = sys_rand32_get();
+static void angle_sample_handler(struct angle_sub *sub, const struct angle_sample *sample)
+{
 	struct bt_ddfs_elevation_measurement elevation;
 	struct bt_ddfs_azimuth_measurement azimuth;
-	const bt_addr_le_t bt_addr = {
-		.type = BT_ADDR_LE_RANDOM,
-		.a.val = {0xFF, 0xEE, 0xDD, 0xCC, 0xBB, 0xAA},
-	};
 
-	elevation.quality = rand % (BT_DDFS_QUALITY_DO_NOT_USE + 1);
-	elevation.value	= -90 + rand % 91;
-	bt_addr_le_copy(&elevation.bt_addr, &bt_addr);
+	elevation.quality = angle_quality_get(sample->quality);
+	elevation.value = sample->elevation;
+	bt_addr_le_copy(&elevation.bt_addr, &sample->addr);
 
-	azimuth.quality = rand % (BT_DDFS_QUALITY_DO_NOT_USE + 1);
-	azimuth.value = rand % 360;
-	bt_addr_le_copy(&azimuth.bt_addr, &bt_addr);
-
-	err = bt_ddfs_elevation_measurement_notify(NULL, &elevation);
-	if (err && (err != -EACCES) && (err != -ENOTCONN)) {
-		printk("Failed to send elevation measurement (err %d)\n", err);
-	}
+	azimuth.quality = angle_quality_get(sample->quality);
+	azimuth.value = sample->azimuth;
+	bt_addr_le_copy(&azimuth.bt_addr, &sample->addr);
 
-	err = bt_ddfs_azimuth_measurement_notify(NULL, &azimuth);
-	if (err && (err != -EACCES) && (err != -ENOTCONN)) {
-		printk("Failed to send azimuth measurement (err %d)\n", err);
-	}
+	angle_notify_result("elevation", bt_ddfs_elevation_measurement_notify(NULL, &elevation));
+	angle_notify_result("azimuth", bt_ddfs_azimuth_measurement_notify(NULL, &azimuth));
 }
 
+static struct angle_sub ddfs_angle_sub = {
+	.cb = angle_sample_handler,
+	.interval_ms = CONFIG_APP_ANGLE_DDFS_INTERVAL_MS,
+};
+#endif /* defined(CONFIG_APP_ANGLE) */
+
 static const struct bt_ddfs_cb cb = {
 	.dm_ranging_mode_set = dm_ranging_mode_set,
 	.dm_config_read = dm_config_read,
@@ -152,10 +169,20 @@ static const struct bt_ddfs_cb cb = {
 int service_ddfs_init(void)
 {
 	struct bt_ddfs_init_params ddfs_init = {0};
+	int err;
 
 	ddfs_init.dm_features.ranging_mode_rtt = 1;
 	ddfs_init.dm_features.ranging_mode_mcpd = 1;
 	ddfs_init.cb = &cb;
 
-	return bt_ddfs_init(&ddfs_init);
+	err = bt_ddfs_init(&ddfs_init);
+	if (err) {
+		return err;
+	}
+
+#if defined(CONFIG_APP_ANGLE)
+	err = angle_subscribe(&ddfs_angle_sub);
+#endif
+
+	return err;
 }
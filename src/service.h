@@ -22,15 +22,10 @@ extern "C" {
  */
 void service_distance_measurement_update(const bt_addr_le_t *addr, const struct dm_result *result);
 
-/** @brief Simulation of azimuth and elevation measurements.
- *
- *  @param None
- */
-void service_azimuth_elevation_simulation(void);
-
 /** @brief Initialize the Direction and Distance Finding Service.
  *
- *  @param None
+ *  Subscribes to the angle source to notify the azimuth and elevation
+ *  measurements at most every CONFIG_APP_ANGLE_DDFS_INTERVAL_MS.
  *
  *  @retval 0 if the operation was successful, otherwise a (negative) error code.
  */
@@ -0,0 +1,576 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/mem_stats.h>
+#include <zephyr/shell/shell.h>
+
+#include "peer.h"
+#include "stats.h"
+
+/* Width of a single latency histogram bucket. */
+#define LATENCY_BUCKET_US       500
+/* Number of latency histogram buckets, the last one collects the overflow. */
+#define LATENCY_BUCKET_COUNT    64
+
+struct latency_hist {
+	atomic_t buckets[LATENCY_BUCKET_COUNT];
+	atomic_t max;
+};
+
+struct duration_stats {
+	atomic_t count;
+	atomic_t last;
+	atomic_t max;
+};
+
+struct msgq_stats {
+	const char *name;
+	struct k_msgq *msgq;
+	atomic_t peak;
+	atomic_t drops;
+};
+
+static struct msgq_stats msgq_stats[STATS_MSGQ_COUNT] = {
+	[STATS_MSGQ_HIDS]   = { .name = "hids_queue" },
+	[STATS_MSGQ_MITM]   = { .name = "mitm_queue" },
+	[STATS_MSGQ_RESULT] = { .name = "result_msgq" },
+};
+
+static atomic_t hid_reports;
+static atomic_t hid_merges;
+static struct latency_hist hid_latency;
+static struct latency_hist hid_age;
+static atomic_t hid_notifications[STATS_HID_REPORT_ID_MAX + 1];
+static atomic_t boot_times[STATS_BOOT_PHASE_COUNT];
+
+static const char *const boot_phase_names[STATS_BOOT_PHASE_COUNT] = {
+	[STATS_BOOT_BT_READY]         = "bt ready",
+	[STATS_BOOT_SETTINGS_LOADED]  = "settings loaded",
+	[STATS_BOOT_FIRST_ADV]        = "first adv",
+	[STATS_BOOT_FIRST_CONN]       = "first connection",
+	[STATS_BOOT_FIRST_REPORT]     = "first report",
+};
+
+static struct duration_stats bt_reconnect;
+static struct duration_stats bt_first_report;
+static struct duration_stats bt_resume;
+static struct duration_stats bt_wake;
+static atomic_t led_updates;
+static atomic_t led_writes;
+static atomic_t airtime_dm_requests;
+static atomic_t airtime_dm_dropped;
+static atomic_t airtime_conn_events_skipped;
+static atomic_t angle_samples;
+static atomic_t angle_notifications;
+static atomic_t angle_failures;
+/* Uptime in milliseconds of the last reset, the start of the rates. */
+static atomic_t reset_time;
+
+static void atomic_max(atomic_t *target, atomic_val_t value)
+{
+	atomic_val_t old;
+
+	do {
+		old = atomic_get(target);
+		if (value <= old) {
+			return;
+		}
+	} while (!atomic_cas(target, old, value));
+}
+
+void stats_msgq_register(enum stats_msgq id, struct k_msgq *msgq)
+{
+	msgq_stats[id].msgq = msgq;
+}
+
+void stats_msgq_put(enum stats_msgq id, struct k_msgq *msgq, int err)
+{
+	struct msgq_stats *stats = &msgq_stats[id];
+
+	stats->msgq = msgq;
+
+	if (err) {
+		atomic_inc(&stats->drops);
+		return;
+	}
+
+	atomic_max(&stats->peak, k_msgq_num_used_get(msgq));
+}
+
+uint32_t stats_msgq_peak_get(enum stats_msgq id)
+{
+	return atomic_get(&msgq_stats[id].peak);
+}
+
+uint32_t stats_msgq_drops_get(enum stats_msgq id)
+{
+	return atomic_get(&msgq_stats[id].drops);
+}
+
+static void latency_hist_add(struct latency_hist *hist, uint32_t latency_us)
+{
+	size_t bucket = MIN(latency_us / LATENCY_BUCKET_US, LATENCY_BUCKET_COUNT - 1);
+
+	atomic_inc(&hist->buckets[bucket]);
+	atomic_max(&hist->max, latency_us);
+}
+
+static uint32_t latency_hist_percentile(struct latency_hist *hist, uint8_t percentile)
+{
+	uint32_t total = 0;
+	uint32_t threshold;
+	uint32_t count = 0;
+
+	for (size_t i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+		total += atomic_get(&hist->buckets[i]);
+	}
+
+	if (!total) {
+		return 0;
+	}
+
+	threshold = DIV_ROUND_UP(total * MIN(percentile, 100), 100);
+
+	for (size_t i = 0; i < LATENCY_BUCKET_COUNT - 1; i++) {
+		count += atomic_get(&hist->buckets[i]);
+		if (count >= threshold) {
+			return (i + 1) * LATENCY_BUCKET_US;
+		}
+	}
+
+	return atomic_get(&hist->max);
+}
+
+static void latency_hist_reset(struct latency_hist *hist)
+{
+	for (size_t i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+		atomic_clear(&hist->buckets[i]);
+	}
+
+	atomic_clear(&hist->max);
+}
+
+static void duration_add(struct duration_stats *stats, uint32_t time_us)
+{
+	atomic_inc(&stats->count);
+	atomic_set(&stats->last, time_us);
+	atomic_max(&stats->max, time_us);
+}
+
+static void duration_get(struct duration_stats *stats, struct stats_duration *duration)
+{
+	duration->count = atomic_get(&stats->count);
+	duration->last_us = atomic_get(&stats->last);
+	duration->max_us = atomic_get(&stats->max);
+}
+
+static void duration_reset(struct duration_stats *stats)
+{
+	atomic_clear(&stats->count);
+	atomic_clear(&stats->last);
+	atomic_clear(&stats->max);
+}
+
+void stats_hid_report_sent(uint32_t latency_us)
+{
+	atomic_inc(&hid_reports);
+	latency_hist_add(&hid_latency, latency_us);
+}
+
+void stats_hid_report_age(uint32_t age_us)
+{
+	latency_hist_add(&hid_age, age_us);
+}
+
+void stats_hid_notified(uint8_t report_id)
+{
+	if (report_id <= STATS_HID_REPORT_ID_MAX) {
+		atomic_inc(&hid_notifications[report_id]);
+	}
+}
+
+void stats_hid_merged(void)
+{
+	atomic_inc(&hid_merges);
+}
+
+void stats_hid_get(struct stats_hid *hid)
+{
+	hid->reports = atomic_get(&hid_reports);
+	hid->merges = atomic_get(&hid_merges);
+	hid->latency_max_us = atomic_get(&hid_latency.max);
+	hid->age_max_us = atomic_get(&hid_age.max);
+
+	for (size_t i = 0; i < ARRAY_SIZE(hid->notifications); i++) {
+		hid->notifications[i] = atomic_get(&hid_notifications[i]);
+	}
+}
+
+uint32_t stats_hid_latency_percentile(uint8_t percentile)
+{
+	return latency_hist_percentile(&hid_latency, percentile);
+}
+
+uint32_t stats_hid_age_percentile(uint8_t percentile)
+{
+	return latency_hist_percentile(&hid_age, percentile);
+}
+
+void stats_bt_reconnect(uint32_t time_us)
+{
+	duration_add(&bt_reconnect, time_us);
+}
+
+void stats_bt_first_report(uint32_t time_us)
+{
+	duration_add(&bt_first_report, time_us);
+}
+
+void stats_bt_resume(uint32_t time_us)
+{
+	duration_add(&bt_resume, time_us);
+}
+
+void stats_bt_wake(uint32_t time_us)
+{
+	duration_add(&bt_wake, time_us);
+}
+
+void stats_bt_get(struct stats_bt *bt)
+{
+	duration_get(&bt_reconnect, &bt->reconnect);
+	duration_get(&bt_first_report, &bt->first_report);
+	duration_get(&bt_resume, &bt->resume);
+	duration_get(&bt_wake, &bt->wake);
+}
+
+void stats_led_update(bool written)
+{
+	atomic_inc(&led_updates);
+	if (written) {
+		atomic_inc(&led_writes);
+	}
+}
+
+void stats_led_get(struct stats_led *led)
+{
+	led->updates = atomic_get(&led_updates);
+	led->writes = atomic_get(&led_writes);
+}
+
+void stats_airtime_dm_request(bool dropped)
+{
+	atomic_inc(dropped ? &airtime_dm_dropped : &airtime_dm_requests);
+}
+
+void stats_airtime_conn_events_skipped(uint32_t count)
+{
+	atomic_add(&airtime_conn_events_skipped, count);
+}
+
+void stats_airtime_get(struct stats_airtime *airtime)
+{
+	airtime->dm_requests = atomic_get(&airtime_dm_requests);
+	airtime->dm_dropped = atomic_get(&airtime_dm_dropped);
+	airtime->conn_events_skipped = atomic_get(&airtime_conn_events_skipped);
+}
+
+void stats_angle_sample(void)
+{
+	atomic_inc(&angle_samples);
+}
+
+void stats_angle_notified(bool sent)
+{
+	atomic_inc(sent ? &angle_notifications : &angle_failures);
+}
+
+void stats_angle_get(struct stats_angle *angle)
+{
+	angle->samples = atomic_get(&angle_samples);
+	angle->notifications = atomic_get(&angle_notifications);
+	angle->failures = atomic_get(&angle_failures);
+}
+
+void stats_boot_mark(enum stats_boot_phase phase)
+{
+	/* A phase reached right at reset still reads as reached. */
+	uint32_t time_us = MAX(k_ticks_to_us_floor32(k_uptime_ticks()), 1);
+
+	(void)atomic_cas(&boot_times[phase], 0, time_us);
+}
+
+uint32_t stats_boot_time_get(enum stats_boot_phase phase)
+{
+	return atomic_get(&boot_times[phase]);
+}
+
+void stats_reset(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(msgq_stats); i++) {
+		atomic_clear(&msgq_stats[i].peak);
+		atomic_clear(&msgq_stats[i].drops);
+	}
+
+	latency_hist_reset(&hid_latency);
+	latency_hist_reset(&hid_age);
+
+	for (size_t i = 0; i < ARRAY_SIZE(hid_notifications); i++) {
+		atomic_clear(&hid_notifications[i]);
+	}
+
+	atomic_clear(&hid_reports);
+	atomic_clear(&hid_merges);
+
+	duration_reset(&bt_reconnect);
+	duration_reset(&bt_first_report);
+	duration_reset(&bt_resume);
+	duration_reset(&bt_wake);
+
+	atomic_clear(&led_updates);
+	atomic_clear(&led_writes);
+
+	atomic_clear(&airtime_dm_requests);
+	atomic_clear(&airtime_dm_dropped);
+	atomic_clear(&airtime_conn_events_skipped);
+
+	atomic_clear(&angle_samples);
+	atomic_clear(&angle_notifications);
+	atomic_clear(&angle_failures);
+
+	atomic_set(&reset_time, k_uptime_get_32());
+}
+
+static void msgq_stats_print(const struct shell *sh)
+{
+	shell_print(sh, "%-12s %6s %6s %6s %6s", "queue", "used", "peak", "size", "drops");
+
+	for (size_t i = 0; i < ARRAY_SIZE(msgq_stats); i++) {
+		struct msgq_stats *stats = &msgq_stats[i];
+		uint32_t used = 0;
+		uint32_t size = 0;
+
+		if (stats->msgq) {
+			used = k_msgq_num_used_get(stats->msgq);
+			size = stats->msgq->max_msgs;
+		}
+
+		shell_print(sh, "%-12s %6u %6u %6u %6u", stats->name, used,
+			    (uint32_t)atomic_get(&stats->peak), size,
+			    (uint32_t)atomic_get(&stats->drops));
+	}
+}
+
+static void hid_stats_print(const struct shell *sh)
+{
+	struct stats_hid hid;
+
+	stats_hid_get(&hid);
+
+	shell_print(sh, "hid: reports %u, merges %u", hid.reports, hid.merges);
+	shell_print(sh, "hid notifications: boot %u, id1 %u, id2 %u, id3 %u",
+		    hid.notifications[STATS_HID_BOOT_REPORT_ID], hid.notifications[1],
+		    hid.notifications[2], hid.notifications[3]);
+	shell_print(sh, "hid latency: p50 %u us, p90 %u us, p99 %u us, max %u us",
+		    stats_hid_latency_percentile(50), stats_hid_latency_percentile(90),
+		    stats_hid_latency_percentile(99), hid.latency_max_us);
+	shell_print(sh, "hid age at transmit: p50 %u us, p90 %u us, p99 %u us, max %u us",
+		    stats_hid_age_percentile(50), stats_hid_age_percentile(90),
+		    stats_hid_age_percentile(99), hid.age_max_us);
+}
+
+static void bt_stats_print(const struct shell *sh)
+{
+	struct stats_bt bt;
+
+	stats_bt_get(&bt);
+
+	shell_print(sh, "bt reconnects: %u, last %u ms, max %u ms", bt.reconnect.count,
+		    bt.reconnect.last_us / USEC_PER_MSEC, bt.reconnect.max_us / USEC_PER_MSEC);
+	shell_print(sh, "bt connect to first report: %u, last %u ms, max %u ms",
+		    bt.first_report.count, bt.first_report.last_us / USEC_PER_MSEC,
+		    bt.first_report.max_us / USEC_PER_MSEC);
+	shell_print(sh, "bt resumes: %u, last %u us, max %u us", bt.resume.count,
+		    bt.resume.last_us, bt.resume.max_us);
+	shell_print(sh, "bt host wakes: %u, last %u ms, max %u ms", bt.wake.count,
+		    bt.wake.last_us / USEC_PER_MSEC, bt.wake.max_us / USEC_PER_MSEC);
+}
+
+static void led_stats_print(const struct shell *sh)
+{
+	struct stats_led led;
+
+	stats_led_get(&led);
+
+	shell_print(sh, "led: updates %u, pwm writes %u", led.updates, led.writes);
+}
+
+static void airtime_stats_print(const struct shell *sh)
+{
+	struct stats_airtime airtime;
+
+	stats_airtime_get(&airtime);
+
+	shell_print(sh, "airtime: dm requests %u, dropped %u, conn events skipped %u",
+		    airtime.dm_requests, airtime.dm_dropped, airtime.conn_events_skipped);
+}
+
+static void throughput_stats_print(const struct shell *sh)
+{
+	uint32_t elapsed_ms = MAX(k_uptime_get_32() - (uint32_t)atomic_get(&reset_time), 1);
+	struct stats_angle angle;
+	struct stats_hid hid;
+
+	stats_hid_get(&hid);
+	stats_angle_get(&angle);
+
+	shell_print(sh, "angle: samples %u, notifications %u, failures %u", angle.samples,
+		    angle.notifications, angle.failures);
+	shell_print(sh, "throughput over %u s: hid %llu reports/s, angle %llu notifications/s",
+		    elapsed_ms / MSEC_PER_SEC,
+		    (uint64_t)hid.reports * MSEC_PER_SEC / elapsed_ms,
+		    (uint64_t)angle.notifications * MSEC_PER_SEC / elapsed_ms);
+}
+
+static void heap_stats_print(const struct shell *sh)
+{
+	struct sys_memory_stats heap;
+	int err;
+
+	err = peer_heap_stats_get(&heap);
+	if (err) {
+		shell_print(sh, "peer_heap: unavailable (err %d)", err);
+		return;
+	}
+
+	shell_print(sh, "peer_heap: used %zu, peak %zu, free %zu",
+		    heap.allocated_bytes, heap.max_allocated_bytes, heap.free_bytes);
+}
+
+static void thread_stats_print(const struct k_thread *thread, void *user_data)
+{
+	const struct shell *sh = user_data;
+	size_t size = thread->stack_info.size;
+	size_t unused;
+	const char *name;
+	int err;
+
+	name = k_thread_name_get((k_tid_t)thread);
+	if (!name || !name[0]) {
+		name = "?";
+	}
+
+	err = k_thread_stack_space_get(thread, &unused);
+	if (err) {
+		shell_print(sh, "%-24s %6zu %6s", name, size, "n/a");
+		return;
+	}
+
+	shell_print(sh, "%-24s %6zu %6zu %5zu%%", name, size, size - unused,
+		    size ? ((size - unused) * 100U) / size : 0);
+}
+
+static int cmd_stats_show(const struct shell *sh, size_t argc, char **argv)
+{
+	msgq_stats_print(sh);
+	shell_print(sh, "");
+
+	hid_stats_print(sh);
+	shell_print(sh, "");
+
+	bt_stats_print(sh);
+	shell_print(sh, "");
+
+	if (IS_ENABLED(CONFIG_APP_PWM_LED)) {
+		led_stats_print(sh);
+		shell_print(sh, "");
+	}
+
+	if (IS_ENABLED(CONFIG_APP_AIRTIME)) {
+		airtime_stats_print(sh);
+		shell_print(sh, "");
+	}
+
+	if (IS_ENABLED(CONFIG_APP_ANGLE)) {
+		throughput_stats_print(sh);
+		shell_print(sh, "");
+	}
+
+	heap_stats_print(sh);
+	shell_print(sh, "");
+
+	shell_print(sh, "%-24s %6s %6s %6s", "thread", "stack", "peak", "usage");
+	k_thread_foreach(thread_stats_print, (void *)sh);
+
+	return 0;
+}
+
+static int cmd_stats_boot(const struct shell *sh, size_t argc, char **argv)
+{
+	uint32_t times[STATS_BOOT_PHASE_COUNT];
+	uint8_t order[STATS_BOOT_PHASE_COUNT];
+	size_t reached = 0;
+	uint32_t prev_us = 0;
+
+	/* With the early advertising the phases are not reached in the order
+	 * of the enum, sort the reached ones by time to compute the deltas.
+	 */
+	for (size_t i = 0; i < ARRAY_SIZE(times); i++) {
+		size_t j = reached;
+
+		times[i] = atomic_get(&boot_times[i]);
+		if (!times[i]) {
+			continue;
+		}
+
+		while (j && (times[order[j - 1]] > times[i])) {
+			order[j] = order[j - 1];
+			j--;
+		}
+
+		order[j] = i;
+		reached++;
+	}
+
+	shell_print(sh, "%-18s %10s %10s", "phase", "time [us]", "delta [us]");
+	shell_print(sh, "%-18s %10u %10s", "reset", 0, "-");
+
+	for (size_t i = 0; i < reached; i++) {
+		uint32_t time_us = times[order[i]];
+
+		shell_print(sh, "%-18s %10u %10u", boot_phase_names[order[i]], time_us,
+			    time_us - prev_us);
+		prev_us = time_us;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(times); i++) {
+		if (!times[i]) {
+			shell_print(sh, "%-18s %10s %10s", boot_phase_names[i], "-", "-");
+		}
+	}
+
+	return 0;
+}
+
+static int cmd_stats_reset(const struct shell *sh, size_t argc, char **argv)
+{
+	stats_reset();
+
+	shell_print(sh, "Statistics reset");
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(stats_cmds,
+	SHELL_CMD(show, NULL, "Show queue, heap and stack usage", cmd_stats_show),
+	SHELL_CMD(boot, NULL, "Show the boot phase timestamps", cmd_stats_boot),
+	SHELL_CMD(reset, NULL, "Reset peaks, counters and histograms", cmd_stats_reset),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(stats, &stats_cmds, "Runtime resource statistics", cmd_stats_show);
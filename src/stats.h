@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr/kernel.h>
+
+/** Message queues tracked by the runtime statistics. */
+enum stats_msgq {
+	STATS_MSGQ_HIDS,
+	STATS_MSGQ_MITM,
+	STATS_MSGQ_RESULT,
+
+	STATS_MSGQ_COUNT
+};
+
+/** Boot phases with a timestamp, in their usual order. */
+enum stats_boot_phase {
+	STATS_BOOT_BT_READY,
+	STATS_BOOT_SETTINGS_LOADED,
+	STATS_BOOT_FIRST_ADV,
+	STATS_BOOT_FIRST_CONN,
+	STATS_BOOT_FIRST_REPORT,
+
+	STATS_BOOT_PHASE_COUNT
+};
+
+/* Report ID under which boot protocol reports are counted. */
+#define STATS_HID_BOOT_REPORT_ID 0
+/* Highest report ID with its own notification counter. */
+#define STATS_HID_REPORT_ID_MAX  4
+
+/** HID input report pipeline statistics. */
+struct stats_hid {
+	/** Number of input reports handed over to the HID service. */
+	uint32_t reports;
+	/** Number of queued motion samples merged into a single report. */
+	uint32_t merges;
+	/** Longest sample-to-send latency in microseconds. */
+	uint32_t latency_max_us;
+	/** Oldest sample age at transmission in microseconds. */
+	uint32_t age_max_us;
+	/** Number of notifications per input report ID. */
+	uint32_t notifications[STATS_HID_REPORT_ID_MAX + 1];
+};
+
+/** Statistics of a repeatedly measured duration. */
+struct stats_duration {
+	/** Number of measurements. */
+	uint32_t count;
+	/** Last duration in microseconds. */
+	uint32_t last_us;
+	/** Longest duration in microseconds. */
+	uint32_t max_us;
+};
+
+/** Bluetooth connection statistics. */
+struct stats_bt {
+	/** Disconnect-to-reconnect time of the hosts. */
+	struct stats_duration reconnect;
+	/** Connect-to-first-delivered-report time. */
+	struct stats_duration first_report;
+	/** Bluetooth stack resume time. */
+	struct stats_duration resume;
+	/** Input-to-low-latency-connection time of the suspended hosts. */
+	struct stats_duration wake;
+};
+
+/** PWM LED statistics. */
+struct stats_led {
+	/** Number of requested LED level updates. */
+	uint32_t updates;
+	/** Number of updates that reprogrammed the PWM. */
+	uint32_t writes;
+};
+
+/** Radio time arbitration statistics. */
+struct stats_airtime {
+	/** Number of Distance Measurement requests added. */
+	uint32_t dm_requests;
+	/** Number of Distance Measurement requests dropped. */
+	uint32_t dm_dropped;
+	/** Number of connection events skipped by the controller. */
+	uint32_t conn_events_skipped;
+};
+
+/** Angle source statistics. */
+struct stats_angle {
+	/** Number of samples taken from the angle source. */
+	uint32_t samples;
+	/** Number of angle notifications queued for the hosts. */
+	uint32_t notifications;
+	/** Number of angle notifications that could not be queued. */
+	uint32_t failures;
+};
+
+#if defined(CONFIG_APP_STATS)
+
+/** @brief Register a message queue for the runtime statistics.
+ *
+ *  @param id Tracked queue identifier.
+ *  @param msgq Message queue.
+ */
+void stats_msgq_register(enum stats_msgq id, struct k_msgq *msgq);
+
+/** @brief Account for a message put into a tracked queue.
+ *
+ *  Updates the queue peak occupancy on success and the drop counter
+ *  when the queue had no space left.
+ *
+ *  @param id Tracked queue identifier.
+ *  @param msgq Message queue the message was put into.
+ *  @param err Value returned by k_msgq_put().
+ */
+void stats_msgq_put(enum stats_msgq id, struct k_msgq *msgq, int err);
+
+/** @brief Get the peak occupancy of a tracked queue.
+ *
+ *  @param id Tracked queue identifier.
+ *
+ *  @retval Peak number of used entries.
+ */
+uint32_t stats_msgq_peak_get(enum stats_msgq id);
+
+/** @brief Get the number of messages dropped by a tracked queue.
+ *
+ *  @param id Tracked queue identifier.
+ *
+ *  @retval Number of dropped messages.
+ */
+uint32_t stats_msgq_drops_get(enum stats_msgq id);
+
+/** @brief Account for an input report handed over to the HID service.
+ *
+ *  @param latency_us Time from the oldest sample in the report to sending.
+ */
+void stats_hid_report_sent(uint32_t latency_us);
+
+/** @brief Account for a motion report transmitted to a host.
+ *
+ *  @param age_us Time from the oldest sample in the report to the
+ *                completion of its notification.
+ */
+void stats_hid_report_age(uint32_t age_us);
+
+/** @brief Account for an input report notification.
+ *
+ *  @param report_id Report ID, or STATS_HID_BOOT_REPORT_ID for boot reports.
+ */
+void stats_hid_notified(uint8_t report_id);
+
+/** @brief Account for a motion sample merged into a pending report. */
+void stats_hid_merged(void);
+
+/** @brief Get the HID input report pipeline statistics.
+ *
+ *  @param hid Statistics to fill.
+ */
+void stats_hid_get(struct stats_hid *hid);
+
+/** @brief Get a sample-to-send latency percentile.
+ *
+ *  @param percentile Percentile from 1 to 100.
+ *
+ *  @retval Latency upper bound in microseconds.
+ */
+uint32_t stats_hid_latency_percentile(uint8_t percentile);
+
+/** @brief Get a sample age at transmission percentile.
+ *
+ *  @param percentile Percentile from 1 to 100.
+ *
+ *  @retval Age upper bound in microseconds.
+ */
+uint32_t stats_hid_age_percentile(uint8_t percentile);
+
+/** @brief Account for a host reconnecting after its disconnection.
+ *
+ *  @param time_us Time from the disconnection to the new connection.
+ */
+void stats_bt_reconnect(uint32_t time_us);
+
+/** @brief Account for the first input report delivered on a connection.
+ *
+ *  @param time_us Time from the connection to the completion of the first
+ *                 report notification.
+ */
+void stats_bt_first_report(uint32_t time_us);
+
+/** @brief Account for a Bluetooth stack resume.
+ *
+ *  @param time_us Time from the resume request to the advertising start.
+ */
+void stats_bt_resume(uint32_t time_us);
+
+/** @brief Account for a suspended host woken up by input.
+ *
+ *  @param time_us Time from the input to the update of the connection to
+ *                 low latency parameters.
+ */
+void stats_bt_wake(uint32_t time_us);
+
+/** @brief Get the Bluetooth connection statistics.
+ *
+ *  @param bt Statistics to fill.
+ */
+void stats_bt_get(struct stats_bt *bt);
+
+/** @brief Account for a requested PWM LED level update.
+ *
+ *  @param written True if the PWM was reprogrammed, false if the update
+ *                 was suppressed.
+ */
+void stats_led_update(bool written);
+
+/** @brief Get the PWM LED statistics.
+ *
+ *  @param led Statistics.
+ */
+void stats_led_get(struct stats_led *led);
+
+/** @brief Account for an arbitrated Distance Measurement request.
+ *
+ *  @param dropped True if the request was dropped, false if it was added.
+ */
+void stats_airtime_dm_request(bool dropped);
+
+/** @brief Account for connection events skipped by the controller.
+ *
+ *  @param count Number of skipped connection events.
+ */
+void stats_airtime_conn_events_skipped(uint32_t count);
+
+/** @brief Get the radio time arbitration statistics.
+ *
+ *  @param airtime Statistics.
+ */
+void stats_airtime_get(struct stats_airtime *airtime);
+
+/** @brief Account for a sample taken from the angle source. */
+void stats_angle_sample(void);
+
+/** @brief Account for an angle notification.
+ *
+ *  @param sent True if the notification was queued, false if it failed.
+ */
+void stats_angle_notified(bool sent);
+
+/** @brief Get the angle source statistics.
+ *
+ *  @param angle Statistics.
+ */
+void stats_angle_get(struct stats_angle *angle);
+
+/** @brief Record the time a boot phase is reached.
+ *
+ *  Only the first call for a phase is recorded.
+ *
+ *  @param phase Boot phase.
+ */
+void stats_boot_mark(enum stats_boot_phase phase);
+
+/** @brief Get the time a boot phase was reached.
+ *
+ *  @param phase Boot phase.
+ *
+ *  @retval Time from reset in microseconds, 0 if not reached yet.
+ */
+uint32_t stats_boot_time_get(enum stats_boot_phase phase);
+
+/** @brief Reset all peaks, counters and histograms. */
+void stats_reset(void);
+
+#else
+
+static inline void stats_msgq_register(enum stats_msgq id, struct k_msgq *msgq) {}
+static inline void stats_msgq_put(enum stats_msgq id, struct k_msgq *msgq, int err) {}
+static inline uint32_t stats_msgq_peak_get(enum stats_msgq id) { return 0; }
+static inline uint32_t stats_msgq_drops_get(enum stats_msgq id) { return 0; }
+static inline void stats_hid_report_sent(uint32_t latency_us) {}
+static inline void stats_hid_report_age(uint32_t age_us) {}
+static inline void stats_hid_notified(uint8_t report_id) {}
+static inline void stats_hid_merged(void) {}
+static inline void stats_hid_get(struct stats_hid *hid) { *hid = (struct stats_hid){0}; }
+static inline uint32_t stats_hid_latency_percentile(uint8_t percentile) { return 0; }
+static inline uint32_t stats_hid_age_percentile(uint8_t percentile) { return 0; }
+static inline void stats_bt_reconnect(uint32_t time_us) {}
+static inline void stats_bt_first_report(uint32_t time_us) {}
+static inline void stats_bt_resume(uint32_t time_us) {}
+static inline void stats_bt_wake(uint32_t time_us) {}
+static inline void stats_bt_get(struct stats_bt *bt) { *bt = (struct stats_bt){0}; }
+static inline void stats_led_update(bool written) {}
+static inline void stats_led_get(struct stats_led *led) { *led = (struct stats_led){0}; }
+static inline void stats_airtime_dm_request(bool dropped) {}
+static inline void stats_airtime_conn_events_skipped(uint32_t count) {}
+static inline void stats_airtime_get(struct stats_airtime *airtime)
+{
+	*airtime = (struct stats_airtime){0};
+}
+static inline void stats_angle_sample(void) {}
+static inline void stats_angle_notified(bool sent) {}
+static inline void stats_angle_get(struct stats_angle *angle) { *angle = (struct stats_angle){0}; }
+static inline void stats_boot_mark(enum stats_boot_phase phase) {}
+static inline uint32_t stats_boot_time_get(enum stats_boot_phase phase) { return 0; }
+static inline void stats_reset(void) {}
+
+#endif /* defined(CONFIG_APP_STATS) */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STATS_H_ */
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <stdio.h>
+#include <zephyr/ztest.h>
+
+#include "mouse_report.h"
+
+#if defined(CONFIG_APP_HID_COMBINED_REPORT)
+/* The motion follows the buttons in the buttons report. */
+#define MOTION_REP_LEN          HID_REPORT_LEN(INPUT_REP_BUTTONS)
+#else
+#define MOTION_REP_LEN          HID_REPORT_LEN(INPUT_REP_MOVEMENT)
+#endif
+#define MOTION_LEN              (2 * MOVEMENT_AXIS_BITS / 8)
+#define BUTTONS_REP_LEN         HID_REPORT_LEN(INPUT_REP_BUTTONS)
+#define RES_MULT_REP_LEN        HID_REPORT_LEN(FEATURE_REP_RES_MULT)
+
+/* Pattern to catch the bytes written out of the expected fields. */
+#define FILL                    0xa5
+
+struct motion_vector {
+	int16_t x;
+	int16_t y;
+	uint8_t bytes[MOTION_LEN];
+};
+
+struct buttons_vector {
+	uint8_t state;
+	int8_t wheel;
+	int8_t pan;
+	int16_t x;
+	int16_t y;
+	uint8_t bytes[BUTTONS_REP_LEN];
+};
+
+#if defined(CONFIG_APP_HID_MOTION_16BIT)
+/* Both axes are little endian 16-bit fields. */
+static const struct motion_vector motion_vectors[] = {
+	{      0,      0, { 0x00, 0x00, 0x00, 0x00 } },
+	{      1,      0, { 0x01, 0x00, 0x00, 0x00 } },
+	{     -1,      0, { 0xff, 0xff, 0x00, 0x00 } },
+	{      0,      1, { 0x00, 0x00, 0x01, 0x00 } },
+	{      0,     -1, { 0x00, 0x00, 0xff, 0xff } },
+	{   -100,     50, { 0x9c, 0xff, 0x32, 0x00 } },
+	{  32767, -32767, { 0xff, 0x7f, 0x01, 0x80 } },
+	/* Only -32768 is out of the logical range. */
+	{ -32768,  32767, { 0x01, 0x80, 0xff, 0x7f } },
+};
+#else
+/* X in bits 0-11, Y in bits 12-23. */
+static const struct motion_vector motion_vectors[] = {
+	{      0,      0, { 0x00, 0x00, 0x00 } },
+	{      1,      0, { 0x01, 0x00, 0x00 } },
+	{     -1,      0, { 0xff, 0x0f, 0x00 } },
+	{      0,      1, { 0x00, 0x10, 0x00 } },
+	{      0,     -1, { 0x00, 0xf0, 0xff } },
+	{     -1,     -1, { 0xff, 0xff, 0xff } },
+	{   -100,     50, { 0x9c, 0x2f, 0x03 } },
+	{   2047,  -2047, { 0xff, 0x17, 0x80 } },
+	{   3000,  -3000, { 0xff, 0x17, 0x80 } },
+	{ -32768,  32767, { 0x01, 0xf8, 0x7f } },
+};
+#endif
+
+#if !defined(CONFIG_APP_HID_COMBINED_REPORT)
+/* Buttons in bits 0-4 and padding, then the wheel and AC Pan bytes. */
+static const struct buttons_vector buttons_vectors[] = {
+	{ 0x00,    0,   0, 0, 0, { 0x00, 0x00, 0x00 } },
+	{ 0x01,    1,  -1, 0, 0, { 0x01, 0x01, 0xff } },
+	{ 0x1f,    0,   0, 0, 0, { 0x1f, 0x00, 0x00 } },
+	/* The buttons above the fifth fall into the padding. */
+	{ 0xff,    0,   0, 0, 0, { 0x1f, 0x00, 0x00 } },
+	{ 0x04, -127, 127, 0, 0, { 0x04, 0x81, 0x7f } },
+	/* The motion is not part of the buttons report. */
+	{ 0x02,   -1,   0, 5, -5, { 0x02, 0xff, 0x00 } },
+};
+#elif defined(CONFIG_APP_HID_MOTION_16BIT)
+/* Buttons byte, X and Y, then the wheel and AC Pan bytes. */
+static const struct buttons_vector buttons_vectors[] = {
+	{ 0x00,    0,   0,      0,      0,
+	  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+	{ 0x01,    1,  -1,      0,      0,
+	  { 0x01, 0x00, 0x00, 0x00, 0x00, 0x01, 0xff } },
+	{ 0xff,    0,   0,     -1,      1,
+	  { 0x1f, 0xff, 0xff, 0x01, 0x00, 0x00, 0x00 } },
+	{ 0x04, -127, 127,  32767, -32767,
+	  { 0x04, 0xff, 0x7f, 0x01, 0x80, 0x81, 0x7f } },
+	{ 0x02,   -1,   0, -32768,  32767,
+	  { 0x02, 0x01, 0x80, 0xff, 0x7f, 0xff, 0x00 } },
+};
+#else
+/* Buttons byte, X and Y in three bytes, then the wheel and AC Pan bytes. */
+static const struct buttons_vector buttons_vectors[] = {
+	{ 0x00,    0,   0,      0,      0,
+	  { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } },
+	{ 0x01,    1,  -1,      0,      0,
+	  { 0x01, 0x00, 0x00, 0x00, 0x01, 0xff } },
+	{ 0xff,    0,   0,     -1,      1,
+	  { 0x1f, 0xff, 0x1f, 0x00, 0x00, 0x00 } },
+	{ 0x04, -127, 127,   2047,  -2047,
+	  { 0x04, 0xff, 0x17, 0x80, 0x81, 0x7f } },
+	{ 0x02,   -1,   0, -32768,  32767,
+	  { 0x02, 0x01, 0xf8, 0x7f, 0xff, 0x00 } },
+};
+#endif
+
+static const char *hex_get(const uint8_t *buf, size_t len)
+{
+	static char str[3 * 8 + 1];
+	size_t pos = 0;
+
+	for (size_t i = 0; (i < len) && (pos + 3 < sizeof(str)); i++) {
+		pos += snprintf(&str[pos], sizeof(str) - pos, "%02x ", buf[i]);
+	}
+
+	str[pos] = '\0';
+
+	return str;
+}
+
+ZTEST(hid_encode, test_report_len)
+{
+	zassert_equal(HID_REPORT_FIELD_BITS(REP_X), MOVEMENT_AXIS_BITS);
+	zassert_equal(HID_REPORT_FIELD_BITS(REP_Y), MOVEMENT_AXIS_BITS);
+#if defined(CONFIG_APP_HID_COMBINED_REPORT)
+	zassert_equal(BUTTONS_REP_LEN, 1 + MOTION_LEN + 2);
+#else
+	zassert_equal(MOTION_REP_LEN, MOTION_LEN);
+	zassert_equal(BUTTONS_REP_LEN, 3);
+#endif
+	zassert_equal(RES_MULT_REP_LEN, 1);
+}
+
+ZTEST(hid_encode, test_motion_bytes)
+{
+	const size_t start = REP_X_OFFSET / 8;
+
+	for (size_t i = 0; i < ARRAY_SIZE(motion_vectors); i++) {
+		const struct motion_vector *v = &motion_vectors[i];
+		uint8_t buffer[MOTION_REP_LEN];
+
+		memset(buffer, FILL, sizeof(buffer));
+		mouse_report_motion_encode(buffer, v->x, v->y);
+
+		zassert_mem_equal(&buffer[start], v->bytes, sizeof(v->bytes),
+				  "x %d, y %d encoded as %s", v->x, v->y,
+				  hex_get(buffer, sizeof(buffer)));
+
+		for (size_t j = 0; j < sizeof(buffer); j++) {
+			if ((j < start) || (j >= start + sizeof(v->bytes))) {
+				zassert_equal(buffer[j], FILL, "byte %zu overwritten", j);
+			}
+		}
+	}
+}
+
+ZTEST(hid_encode, test_motion_clamp)
+{
+	uint8_t clamped[MOTION_REP_LEN] = {0};
+	uint8_t limit[MOTION_REP_LEN] = {0};
+
+	mouse_report_motion_encode(clamped, INT16_MAX, INT16_MIN);
+	mouse_report_motion_encode(limit, MOUSE_MOVEMENT_MAX, -MOUSE_MOVEMENT_MAX);
+
+	zassert_mem_equal(clamped, limit, sizeof(limit));
+	zassert_equal(HID_REPORT_FIELD_GET(clamped, REP_X), MOUSE_MOVEMENT_MAX);
+}
+
+ZTEST(hid_encode, test_buttons_bytes)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(buttons_vectors); i++) {
+		const struct buttons_vector *v = &buttons_vectors[i];
+		uint8_t buffer[BUTTONS_REP_LEN] = {0};
+
+		mouse_report_buttons_encode(buffer, v->state, v->wheel, v->pan, v->x, v->y);
+
+		zassert_mem_equal(buffer, v->bytes, sizeof(buffer),
+				  "buttons 0x%02x, wheel %d, pan %d, x %d, y %d encoded as %s",
+				  v->state, v->wheel, v->pan, v->x, v->y,
+				  hex_get(buffer, sizeof(buffer)));
+	}
+}
+
+ZTEST(hid_encode, test_res_mult)
+{
+	/* Wheel multiplier in bits 0-1, AC Pan multiplier in bits 2-3. */
+	static const struct {
+		bool wheel;
+		bool pan;
+		uint8_t byte;
+	} vectors[] = {
+		{ false, false, 0x00 },
+		{ true,  false, 0x01 },
+		{ false, true,  0x04 },
+		{ true,  true,  0x05 },
+	};
+	bool wheel;
+	bool pan;
+
+	for (size_t i = 0; i < ARRAY_SIZE(vectors); i++) {
+		uint8_t buffer[RES_MULT_REP_LEN] = {0};
+
+		mouse_report_res_mult_encode(buffer, vectors[i].wheel, vectors[i].pan);
+		zassert_equal(buffer[0], vectors[i].byte, "wheel %d, pan %d encoded as %s",
+			      vectors[i].wheel, vectors[i].pan, hex_get(buffer, sizeof(buffer)));
+
+		mouse_report_res_mult_decode(buffer, &wheel, &pan);
+		zassert_equal(wheel, vectors[i].wheel);
+		zassert_equal(pan, vectors[i].pan);
+	}
+
+	/* Any non-zero multiplier enables it, the padding is ignored. */
+	mouse_report_res_mult_decode((const uint8_t []){ 0x02 }, &wheel, &pan);
+	zassert_true(wheel && !pan);
+	mouse_report_res_mult_decode((const uint8_t []){ 0x08 }, &wheel, &pan);
+	zassert_true(!wheel && pan);
+	mouse_report_res_mult_decode((const uint8_t []){ 0xf0 }, &wheel, &pan);
+	zassert_true(!wheel && !pan);
+}
+
+ZTEST_SUITE(hid_encode, NULL, NULL, NULL, NULL, NULL);